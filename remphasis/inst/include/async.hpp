@@ -0,0 +1,134 @@
+#ifndef EMPHASIS_ASYNC_HPP_INCLUDED
+#define EMPHASIS_ASYNC_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "emphasis.hpp"
+
+
+namespace emphasis {
+
+
+  // snapshot of the progress of an asynchronous run
+  struct async_progress_t
+  {
+    int phase = 0;
+    int metaiteration = 0;
+    int iteration = 0;
+    int sample_size = 0;
+    int required_sample_size = 0;
+    double fhat = 0.0;
+    double sde = 0.0;
+    param_t estimates;
+  };
+
+
+  // runs job on a thread of its own.
+  // The job receives the run's deadline and reports progress through report().
+  // The destructor cancels and joins.
+  class async_run_t
+  {
+  public:
+    using job_t = std::function<void(const deadline_t&, async_run_t&)>;
+
+    async_run_t(const async_run_t&) = delete;
+    async_run_t& operator=(const async_run_t&) = delete;
+
+    // budget max_time [s], <= 0: no budget
+    explicit async_run_t(job_t job, double max_time = 0.0)
+      : deadline_(max_time), T0_(std::chrono::steady_clock::now())
+    {
+      thread_ = std::thread([this, job = std::move(job)]() {
+        try {
+          job(deadline_, *this);
+        }
+        catch (...) {
+          error_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> _(mutex_);
+        T1_ = std::chrono::steady_clock::now();
+        done_ = true;
+        cv_.notify_all();
+      });
+    }
+
+    ~async_run_t()
+    {
+      cancel();
+      if (thread_.joinable()) thread_.join();
+    }
+
+    bool done() const
+    {
+      std::lock_guard<std::mutex> _(mutex_);
+      return done_;
+    }
+
+    // waits at most timeout [s], < 0: no timeout. Returns done()
+    bool wait(double timeout)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (timeout < 0.0) {
+        cv_.wait(lock, [this]() { return done_; });
+      }
+      else {
+        cv_.wait_for(lock, std::chrono::duration<double>(timeout), [this]() { return done_; });
+      }
+      return done_;
+    }
+
+    void cancel() noexcept { deadline_.cancel(); }
+    run_status_t status() const noexcept { return deadline_.status(); }
+
+    // worker thread
+    void report(const fit_progress_t& p)
+    {
+      std::lock_guard<std::mutex> _(mutex_);
+      progress_.phase = p.phase;
+      progress_.metaiteration = p.metaiteration;
+      progress_.iteration = p.iteration;
+      progress_.sample_size = p.sample_size;
+      progress_.required_sample_size = p.required_sample_size;
+      progress_.fhat = p.fhat;
+      progress_.sde = p.sde;
+      progress_.estimates = p.estimates;
+    }
+
+    async_progress_t progress() const
+    {
+      std::lock_guard<std::mutex> _(mutex_);
+      return progress_;
+    }
+
+    // rethrows the exception that terminated the job, if any. Requires done()
+    void rethrow() const
+    {
+      if (error_) std::rethrow_exception(error_);
+    }
+
+    // elapsed runtime [ms]
+    double elapsed() const
+    {
+      std::lock_guard<std::mutex> _(mutex_);
+      const auto T1 = done_ ? T1_ : std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::milli>(T1 - T0_).count();
+    }
+
+  private:
+    deadline_t deadline_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ = false;
+    std::exception_ptr error_;
+    async_progress_t progress_;
+    std::chrono::steady_clock::time_point T0_, T1_;
+    std::thread thread_;      // last, starts after the members above
+  };
+
+}
+
+#endif
@@ -3,31 +3,46 @@
 
 #include <vector>
 #include "emphasis.hpp"
+#include "qmc.hpp"
 
 namespace emphasis {
 
-  // thrown if missing branches exceeded
-  class augmentation_overrun : public std::runtime_error
+  enum class augment_status_t
   {
-  public:
-    augmentation_overrun() : std::runtime_error("number of missing branches exceeded") {}
+    accepted = 0,
+    overrun,          // missing branches exceeded
+    lambda,           // lambda exceeded
+    cancelled         // deadline expired
   };
 
 
-  // thrown if lambda exceeded
-  class augmentation_lambda : public std::runtime_error
+  struct augment_result_t
   {
-  public:
-    augmentation_lambda() : std::runtime_error("lambda exceeded") {}
+    augment_status_t status;
+    double t;         // time reached, where the augmentation was aborted if not accepted
   };
 
 
-  void augment_tree(const param_t& pars,
-                    const tree_t& input_tree,
-                    class Model* model,
-                    int max_missing,
-                    double max_lambda,
-                    tree_t& out);
+  // thinning uniforms of one augmentation
+  struct augment_stream_t
+  {
+    uint64_t seed;                        // seeds the random stream
+    const detail::sobol* qmc = nullptr;   // leading uniforms from Sobol' point
+    uint32_t point = 0;
+    bool antithetic = false;              // reflected uniforms
+  };
+
+
+  // augments input_tree into out. Rejections abort early and are
+  // reported in the result.
+  augment_result_t augment_tree(const param_t& pars,
+                                const tree_t& input_tree,
+                                class Model* model,
+                                int max_missing,
+                                double max_lambda,
+                                tree_t& out,
+                                const augment_stream_t& stream,
+                                const deadline_t* deadline = nullptr);
 
 }
 
@@ -0,0 +1,40 @@
+#ifndef EMPHASIS_CHECKPOINT_HPP_INCLUDED
+#define EMPHASIS_CHECKPOINT_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include "emphasis.hpp"
+
+
+namespace emphasis {
+
+
+  // resumable state of fit
+  struct fit_checkpoint_t
+  {
+    uint64_t digest = 0;                // of the fit inputs
+    uint64_t seed = 0;                  // master seed of the E-step streams
+    fit_history_t history;
+    bool has_pool = false;              // tree pool of the current chain
+    tree_pool_t pool;
+    replay_spec_t replay;               // seed-replay pool, regenerated into pool by fit
+    proposal_t proposal;                // adapted proposal of the current chain
+  };
+
+
+  // binary checkpoint, written to file.tmp and renamed
+  void write_checkpoint(const std::string& file,
+                        uint64_t digest,
+                        uint64_t seed,
+                        const fit_history_t& history,
+                        const tree_pool_t* pool,
+                        const proposal_t& proposal = {});
+
+
+  // returns false if file doesn't exist, throws emphasis_error on malformed files
+  bool read_checkpoint(const std::string& file, fit_checkpoint_t& cp);
+
+
+}
+
+#endif
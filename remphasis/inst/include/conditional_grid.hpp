@@ -0,0 +1,85 @@
+#ifndef EMPHASIS_CONDITIONAL_GRID_HPP_INCLUDED
+#define EMPHASIS_CONDITIONAL_GRID_HPP_INCLUDED
+
+#include <vector>
+#include <algorithm>
+#include "emphasis.hpp"
+
+
+namespace emphasis {
+
+
+  // conditional probabilities tabulated on a rectilinear grid over the parameter box.
+  // Multilinear interpolation, parameters outside the box are clamped.
+  // Thread-safe, unlike R closures.
+  class conditional_grid
+  {
+  public:
+    // axes[j]: increasing grid points of parameter j.
+    // values: one per grid point, first axis varies fastest (R array order).
+    conditional_grid(std::vector<std::vector<double>> axes, std::vector<double> values)
+      : axes_(std::move(axes)), values_(std::move(values)), stride_(axes_.size())
+    {
+      size_t size = 1;
+      for (size_t j = 0; j < axes_.size(); ++j) {
+        const auto& a = axes_[j];
+        if (a.empty() || !std::is_sorted(a.cbegin(), a.cend()) || (std::adjacent_find(a.cbegin(), a.cend()) != a.cend())) {
+          throw emphasis_error("conditional_grid: axes must be strictly increasing");
+        }
+        stride_[j] = size;
+        size *= a.size();
+      }
+      if (size != values_.size()) {
+        throw emphasis_error("conditional_grid: size of values doesn't match axes");
+      }
+    }
+
+    size_t nparams() const noexcept { return axes_.size(); }
+
+    double operator()(const param_t& pars) const
+    {
+      if (pars.size() != axes_.size()) {
+        throw emphasis_error("conditional_grid: invalid number of parameters");
+      }
+      // cell and local coordinate per axis
+      size_t base = 0;
+      std::vector<size_t> step(axes_.size(), 0);
+      std::vector<double> t(axes_.size(), 0.0);
+      for (size_t j = 0; j < axes_.size(); ++j) {
+        const auto& a = axes_[j];
+        if (a.size() == 1) continue;
+        const double x = std::min(a.back(), std::max(a.front(), pars[j]));
+        const size_t i = std::min<size_t>(a.size() - 2, std::upper_bound(a.cbegin(), a.cend(), x) - a.cbegin() - 1);
+        base += i * stride_[j];
+        step[j] = stride_[j];
+        t[j] = (x - a[i]) / (a[i + 1] - a[i]);
+      }
+      // weighted sum over the 2^n cell corners
+      double sum = 0.0;
+      const size_t corners = size_t(1) << axes_.size();
+      for (size_t c = 0; c < corners; ++c) {
+        double w = 1.0;
+        size_t k = base;
+        for (size_t j = 0; (j < axes_.size()) && (w != 0.0); ++j) {
+          if (c & (size_t(1) << j)) {
+            w *= t[j];
+            k += step[j];
+          }
+          else {
+            w *= 1.0 - t[j];
+          }
+        }
+        if (w != 0.0) sum += w * values_[k];
+      }
+      return sum;
+    }
+
+  private:
+    std::vector<std::vector<double>> axes_;
+    std::vector<double> values_;
+    std::vector<size_t> stride_;
+  };
+
+}
+
+#endif
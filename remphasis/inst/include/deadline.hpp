@@ -0,0 +1,114 @@
+#ifndef EMPHASIS_DEADLINE_HPP_INCLUDED
+#define EMPHASIS_DEADLINE_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <functional>
+
+
+#ifndef EMPHASIS_DEADLINE_CHECK_INTERVAL
+#define EMPHASIS_DEADLINE_CHECK_INTERVAL 64   // calls to expired() between clock reads, per thread
+#endif
+
+#ifndef EMPHASIS_DEADLINE_POLL_INTERVAL
+#define EMPHASIS_DEADLINE_POLL_INTERVAL 100   // [ms] between polls
+#endif
+
+
+namespace emphasis {
+
+
+  enum class run_status_t
+  {
+    completed = 0,
+    deadline = 1,     // wall-clock budget exhausted
+    cancelled = 2     // cancel() or poll
+  };
+
+
+  inline const char* status_string(run_status_t status)
+  {
+    switch (status) {
+      case run_status_t::deadline: return "deadline";
+      case run_status_t::cancelled: return "cancelled";
+      default: return "completed";
+    }
+  }
+
+
+  // wall-clock budget and cooperative cancellation.
+  // expired() is cheap enough for inner loops; the clock is read every
+  // EMPHASIS_DEADLINE_CHECK_INTERVAL calls per thread. The poll function
+  // is only called from the thread that constructed the deadline.
+  class deadline_t
+  {
+  public:
+    using clock_t = std::chrono::steady_clock;
+    using poll_t = std::function<bool()>;   // returns true to cancel
+
+    deadline_t(const deadline_t&) = delete;
+    deadline_t& operator=(const deadline_t&) = delete;
+
+    // budget [s], <= 0 or inf: no budget
+    explicit deadline_t(double budget = 0.0, poll_t poll = {})
+      : poll_(std::move(poll)),
+      owner_(std::this_thread::get_id()),
+      last_poll_(clock_t::now())
+    {
+      if ((budget > 0.0) && (budget < std::numeric_limits<double>::infinity())) {
+        end_ = last_poll_ + std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(budget));
+        timed_ = true;
+      }
+    }
+
+    void cancel() noexcept 
+    { 
+      stop_.store(static_cast<int>(run_status_t::cancelled), std::memory_order_relaxed); 
+    }
+    
+    run_status_t status() const noexcept 
+    { 
+      return static_cast<run_status_t>(stop_.load(std::memory_order_relaxed)); 
+    }
+
+    bool expired() const
+    {
+      if (stop_.load(std::memory_order_relaxed)) return true;
+      static thread_local unsigned ticks = 0;
+      if (++ticks % EMPHASIS_DEADLINE_CHECK_INTERVAL) return false;
+      return check();
+    }
+
+    // reads the clock and polls, regardless of the check interval
+    bool check() const
+    {
+      if (stop_.load(std::memory_order_relaxed)) return true;
+      const auto now = clock_t::now();
+      if (timed_ && (now > end_)) {
+        stop_.store(static_cast<int>(run_status_t::deadline), std::memory_order_relaxed);
+        return true;
+      }
+      if (poll_ && (std::this_thread::get_id() == owner_) && (now - last_poll_ > std::chrono::milliseconds(EMPHASIS_DEADLINE_POLL_INTERVAL))) {
+        last_poll_ = now;
+        if (poll_()) {
+          stop_.store(static_cast<int>(run_status_t::cancelled), std::memory_order_relaxed);
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    poll_t poll_;
+    std::thread::id owner_;
+    mutable clock_t::time_point last_poll_;   // owner thread only
+    clock_t::time_point end_;
+    bool timed_ = false;
+    mutable std::atomic<int> stop_{ 0 };
+  };
+
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef EMPHASIS_DELTA_TREE_HPP_INCLUDED
+#define EMPHASIS_DELTA_TREE_HPP_INCLUDED
+
+#include <vector>
+#include <algorithm>
+#include "plugin.hpp"
+#include "model_helpers.hpp"
+
+
+namespace emphasis {
+
+
+  // inserted (missing) lineage
+  struct lineage_t
+  {
+    double brts;      // speciation
+    double t_ext;     // extinction
+  };
+
+
+  // augmented trees stored as inserted lineages relative to the shared
+  // observed tree (backbone). Lineages are kept in CSR layout, sorted by brts.
+  class delta_trees
+  {
+  public:
+    delta_trees() = default;
+    explicit delta_trees(tree_t backbone) : backbone_(std::move(backbone)), offset_(1, 0) {}
+
+    size_t size() const noexcept { return offset_.empty() ? 0 : offset_.size() - 1; }
+    bool empty() const noexcept { return size() == 0; }
+    const tree_t& backbone() const noexcept { return backbone_; }
+
+    // number of lineages inserted into tree i
+    size_t missing(size_t i) const noexcept { return offset_[i + 1] - offset_[i]; }
+
+    // stored bytes
+    size_t bytes() const noexcept
+    {
+      return sizeof(node_t) * backbone_.size() + sizeof(size_t) * offset_.size() + sizeof(lineage_t) * lineages_.size();
+    }
+
+    void reserve(size_t trees, size_t lineages)
+    {
+      offset_.reserve(trees + 1);
+      lineages_.reserve(lineages);
+    }
+
+    // extracts the inserted lineages of an augmentation of the backbone
+    void push_back(const tree_t& augmented)
+    {
+      for (const auto& node : augmented) {
+        if (detail::is_missing(node)) {
+          lineages_.push_back({ node.brts, node.t_ext });
+        }
+      }
+      offset_.push_back(lineages_.size());
+    }
+
+    // appends tree i of other, sharing the same backbone
+    void push_back(const delta_trees& other, size_t i)
+    {
+      lineages_.insert(lineages_.end(), other.lineages_.cbegin() + other.offset_[i], other.lineages_.cbegin() + other.offset_[i + 1]);
+      offset_.push_back(lineages_.size());
+    }
+
+    // materializes tree i into out: merge-walk of backbone, speciations and extinctions.
+    // n and pd are rederived in linear time; on ties extinctions precede speciations
+    // precede backbone nodes, matching insertion during augmentation.
+    void expand(size_t i, tree_t& out) const
+    {
+      const lineage_t* first = lineages_.data() + offset_[i];
+      const lineage_t* last = lineages_.data() + offset_[i + 1];
+      auto& ext = ext_scratch();
+      ext.assign(first, last);
+      std::sort(ext.begin(), ext.end(), [](const lineage_t& a, const lineage_t& b) { return a.t_ext < b.t_ext; });
+      out.resize(backbone_.size() + 2 * (last - first));
+      auto bb = backbone_.cbegin();
+      auto sp = first;
+      auto ex = ext.cbegin();
+      double n = backbone_.front().n;
+      for (auto& node : out) {
+        const double tb = (bb != backbone_.cend()) ? bb->brts : detail::huge;
+        const double ts = (sp != last) ? sp->brts : detail::huge;
+        const double te = (ex != ext.cend()) ? ex->t_ext : detail::huge;
+        if (te <= ts && te <= tb) {
+          node = { te, n, t_ext_extinct, ex->brts };    // pd: speciation time, see below
+          n -= 1.0;
+          ++ex;
+        }
+        else if (ts <= tb) {
+          node = { ts, n, sp->t_ext, 0.0 };
+          n += 1.0;
+          ++sp;
+        }
+        else {
+          node = { tb, n, bb->t_ext, 0.0 };
+          n += 1.0;
+          ++bb;
+        }
+      }
+      // pd(tm) = (n0 + m) * tm - S, with m and S the count and sum of brts of the
+      // non-extinction nodes with brts <= tm and t_ext > tm (see detail::calculate_pd)
+      const double n0 = backbone_.front().n;
+      double m = 0.0;
+      double S = 0.0;
+      for (size_t j = 0; j < out.size(); ) {
+        size_t k = j;
+        for (; (k < out.size()) && (out[k].brts == out[j].brts); ++k) {
+          if (detail::is_extinction(out[k])) {
+            m -= 1.0;
+            S -= out[k].pd;
+          }
+          else {
+            m += 1.0;
+            S += out[k].brts;
+          }
+        }
+        const double pd = (n0 + m) * out[j].brts - S;
+        for (; j < k; ++j) {
+          out[j].pd = pd;
+        }
+      }
+    }
+
+  private:
+    static std::vector<lineage_t>& ext_scratch()
+    {
+      static thread_local std::vector<lineage_t> scratch;
+      return scratch;
+    }
+
+    tree_t backbone_;
+    std::vector<size_t> offset_;
+    std::vector<lineage_t> lineages_;
+  };
+
+
+  namespace detail {
+
+    // uniform access to stored trees
+    inline const tree_t& tree_at(const std::vector<tree_t>& trees, size_t i, tree_t&)
+    {
+      return trees[i];
+    }
+
+    inline const tree_t& tree_at(const delta_trees& trees, size_t i, tree_t& scratch)
+    {
+      trees.expand(i, scratch);
+      return scratch;
+    }
+
+  }
+
+}
+
+#endif
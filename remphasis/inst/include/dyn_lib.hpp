@@ -8,21 +8,58 @@
 # include <Windows.h>
 #else
 # include <dlfcn.h>
+# include <unistd.h>
 #endif
 #include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <fstream>
 #include "emphasis.hpp"
 
 
 namespace dll {
 
+  // copies DLL to a unique file in the temp directory.
+  // Loading the copy gives a private instance of the library's globals.
+  inline std::string private_copy(const std::string& DLL)
+  {
+    static std::atomic<unsigned> counter{ 0 };
+    const char* tmp = nullptr;
+    for (const char* var : { "TMPDIR", "TMP", "TEMP" }) {
+      if ((tmp = std::getenv(var))) break;
+    }
+#if defined(_WIN32)
+    const std::string dir = tmp ? tmp : ".";
+    const unsigned long pid = GetCurrentProcessId();
+    const char* ext = ".dll";
+#else
+    const std::string dir = tmp ? tmp : "/tmp";
+    const unsigned long pid = static_cast<unsigned long>(getpid());
+    const char* ext = ".so";
+#endif
+    const std::string copy = dir + "/emp_plugin_" + std::to_string(pid) + "_" + std::to_string(counter++) + ext;
+    std::ifstream is(DLL, std::ios::binary);
+    std::ofstream os(copy, std::ios::binary | std::ios::trunc);
+    if (!(is && os && (os << is.rdbuf()))) {
+      throw emphasis::emphasis_error("Unable to copy dynamic library");
+    }
+    return copy;
+  }
+
 #if defined(_WIN32)
   class dynlib
   {
   public:
-    dynlib(const std::string& DLL)
+    // loads a private copy of DLL if isolated
+    dynlib(const std::string& DLL, bool isolated = false)
     {
-      hModule_ = LoadLibrary(DLL.c_str());
+      if (isolated) {
+        copy_ = private_copy(DLL);
+      }
+      hModule_ = LoadLibrary(isolated ? copy_.c_str() : DLL.c_str());
       if (NULL == hModule_) {
+        if (isolated) std::remove(copy_.c_str());
         throw emphasis::emphasis_error("Unable to load dynamic library");
       }
     }
@@ -32,8 +69,14 @@ namespace dll {
       if (hModule_) {
         FreeLibrary(hModule_);
       }
+      if (!copy_.empty()) {
+        std::remove(copy_.c_str());   // locked while loaded
+      }
     }
 
+    dynlib(const dynlib&) = delete;
+    dynlib& operator=(const dynlib&) = delete;
+
     template <typename FPTR>
     FPTR get_address(const char* fname, bool optional)
     {
@@ -44,6 +87,7 @@ namespace dll {
 
   private:
     HMODULE hModule_ = NULL;
+    std::string copy_;
   };
 
 #else // _WIN32
@@ -51,9 +95,17 @@ namespace dll {
   class dynlib
   {
   public:
-    dynlib(const std::string& DLL)
+    // loads a private copy of DLL if isolated
+    dynlib(const std::string& DLL, bool isolated = false)
     {
-      hModule_ = dlopen(DLL.c_str(), RTLD_LAZY);
+      if (isolated) {
+        const std::string copy = private_copy(DLL);
+        hModule_ = dlopen(copy.c_str(), RTLD_LAZY | RTLD_LOCAL);
+        std::remove(copy.c_str());    // stays mapped
+      }
+      else {
+        hModule_ = dlopen(DLL.c_str(), RTLD_LAZY);
+      }
       if (nullptr == hModule_) {
         throw emphasis::emphasis_error("Unable to load dynamic library");
       }
@@ -66,6 +118,9 @@ namespace dll {
       }
     }
 
+    dynlib(const dynlib&) = delete;
+    dynlib& operator=(const dynlib&) = delete;
+
     template <typename FPTR>
     FPTR get_address(const char* fname, bool optional)
     {
@@ -27,11 +27,15 @@
 #define EMPHASIS_EMPHASIS_HPP_INCLUDED
 
 #include <stdexcept>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <vector>
 #include <functional>
 #include "plugin.hpp"
+#include "delta_tree.hpp"
+#include "replay_tree.hpp"
+#include "deadline.hpp"
 
 
 namespace emphasis {
@@ -62,16 +66,88 @@ namespace emphasis {
     ~E_step_t() {};
 
     std::vector<tree_t> trees;          // augmented trees
+    delta_trees deltas;                 // augmented trees, compact (instead of trees)
+    replay_trees replay;                // augmented trees, seed-replay (instead of trees)
+    const struct tree_pool_t* pooled = nullptr;   // trees held by this pool (instead of trees), see mcem
     std::vector<double> weights;
+    std::vector<double> logf;           // log-likelihoods
+    std::vector<double> logg;           // proposal log-densities
     double fhat;                        // mean, unscaled, weight
+    double fhat_var = 0;                // variance of fhat (log scale, delta method) across sampler replicates
+    double ess = 0;                     // effective sample size
+    int pruned = 0;                     // # trees removed by prune
+    double discarded_mass = 0;          // relative weight of the removed trees
+    double pruned_ess = 0;              // effective sample size after prune
+    bool recycled = false;              // trees recycled from tree_pool_t
     int rejected_overruns = 0;          // # trees rejected because overrun of missing branches
     int rejected_lambda = 0;            // # trees rejected because of lambda overrun
     int rejected_zero_weights = 0;      // # trees rejected because of zero-weight
     int rejected = 0;
+    std::vector<double> overrun_times;  // where the overrun rejections aborted, relative to the age of the tree
+    std::vector<double> lambda_times;   // where the lambda rejections aborted, relative to the age of the tree
+    uint64_t seed = 0;                  // sampler seed in use
+    run_status_t status = run_status_t::completed;    // partial sample if not completed
     double elapsed = 0;                 // elapsed runtime [ms]
   };
 
 
+  // source of the thinning uniforms of the augmentation sampler
+  enum class sampler_t
+  {
+    iid,          // pseudo-random
+    sobol,        // randomized Sobol' sequence, one point per augmentation
+    antithetic    // pairs of augmentations with reflected uniforms
+  };
+
+
+  // importance proposal of the augmentation sampler. Trees are augmented
+  // under the parameters of a mixture component, drawn by weight, and are
+  // weighted against the mixture density. The target parameters enter as
+  // defensive component that bounds the importance weights.
+  struct proposal_t
+  {
+    std::vector<param_t> pars;          // components, empty: augment under the target parameters
+    std::vector<double> weights;        // of the components, empty: equal
+    double defensive = 0.1;             // weight of the target parameters, [0, 1)
+  };
+
+
+  struct sampler_control_t
+  {
+    sampler_t type = sampler_t::iid;
+    int replicates = 8;                 // independent randomizations, interleaved by augmentation index
+    uint64_t seed = 0;                  // 0: random seed
+    proposal_t proposal;
+    bool replay = false;                // store augmentation indices, trees are regenerated on use
+    int replay_cache = 0;               // # replayed trees kept after their first regeneration
+  };
+
+
+  // "iid", "sobol" or "antithetic"
+  sampler_t make_sampler_type(const std::string& name);
+
+
+  // reduction of the weighted sample ahead of the M-step
+  enum class prune_t
+  {
+    none,
+    threshold,    // drop trees with w / sum(w) < threshold
+    resample      // systematic resample, stratified by weight
+  };
+
+
+  struct prune_control_t
+  {
+    prune_t type = prune_t::none;
+    double threshold = 1e-6;            // relative weight, prune_t::threshold
+    int size = 0;                       // resample size, 0: ceil(ess)
+  };
+
+
+  // "none", "threshold" or "resample"
+  prune_t make_prune_type(const std::string& name);
+
+
   E_step_t E_step(int N,      // sample size
                   int maxN,   // max number of augmented trees (incl. invalid)
                   const param_t& pars,
@@ -80,7 +156,101 @@ namespace emphasis {
                   int soc = 2,
                   int max_missing = default_max_missing_branches,
                   double max_lambda = default_max_aug_lambda,
-                  int num_threads = 0);
+                  int num_threads = 0,
+                  const sampler_control_t& sampler = {},
+                  bool compact = false,       // store deltas instead of trees, see also sampler.replay
+                  const deadline_t* deadline = nullptr);
+
+
+  // partial E-step over the augmentation indices [first, last).
+  // Shards of a seeded sampler covering [0, M) merge into the E-step
+  // with the same seed.
+  struct E_shard_t
+  {
+    unsigned first = 0;
+    unsigned last = 0;
+    sampler_control_t sampler;
+    std::vector<unsigned char> outcome; // per augmentation: 0 not run, 1 accepted, 2 overrun, 3 lambda, 4 zero-weight
+    std::vector<unsigned> index;        // augmentation index of the accepted trees
+    std::vector<float> reject_time;     // per augmentation, relative time of overrun and lambda rejections
+    E_step_t e;                         // accepted trees in index order, unnormalized log-weights
+  };
+
+
+  E_shard_t E_shard(unsigned first,
+                    unsigned last,
+                    const param_t& pars,
+                    const brts_t& brts,
+                    class Model* model,
+                    int soc = 2,
+                    int max_missing = default_max_missing_branches,
+                    double max_lambda = default_max_aug_lambda,
+                    int num_threads = 0,
+                    const sampler_control_t& sampler = {},   // seed required, no replay
+                    bool compact = false,
+                    const deadline_t* deadline = nullptr);
+
+
+  // combines shards into the E-step of sample size N, 0: all accepted trees.
+  // Moves the trees out of shards.
+  E_step_t merge_shards(std::vector<E_shard_t>& shards, int N = 0);
+
+
+  // removes trees from E according to control; fhat is unaffected
+  void prune(E_step_t& E, const prune_control_t& control);
+
+
+  // augmented trees kept across mcem iterations
+  struct tree_pool_t
+  {
+    std::vector<tree_t> trees;
+    delta_trees deltas;                 // compact pool (instead of trees)
+    replay_trees replay;                // seed-replay pool (instead of trees)
+    std::vector<double> logg;           // proposal log-densities
+    int rejected = 0;                   // rejected trees during the E-step that created the pool
+    int recycled = 0;                   // # iterations the pool was recycled
+  };
+
+
+  // inputs that regenerate the seed-replay trees of an E-step
+  struct replay_spec_t
+  {
+    param_t pars;                       // of the E-step
+    sampler_control_t sampler;          // seed in use
+    tree_t backbone;
+    int max_missing = 0;
+    double max_lambda = 0;
+    std::vector<unsigned> index;        // augmentation indices of the trees
+  };
+
+
+  // throws emphasis_error if trees aren't from E_step
+  replay_spec_t replay_spec(const replay_trees& trees);
+
+
+  // trees of spec, regenerated by model
+  replay_trees make_replay_trees(const replay_spec_t& spec, class Model* model);
+
+
+  // re-weights the trees in pool to pars
+  E_step_t recycle(const param_t& pars,
+                   const tree_pool_t& pool,
+                   class Model* model,
+                   int num_threads = 0);
+
+
+  // proposal for the E-step at pars, tuned on the weighted sample E of the
+  // previous iteration: the defensive component and one component that
+  // minimizes the estimated second moment of the importance weights, 
+  // i.e. maximizes the effective sample size.
+  proposal_t adapt_proposal(const param_t& pars,
+                            const E_step_t& E,
+                            class Model* model,
+                            double defensive = 0.1,
+                            const param_t& lower_bound = {}, // overrides model.lower_bound
+                            const param_t& upper_bound = {}, // overrides model.upper.bound
+                            int num_threads = 0,
+                            int max_evals = 200);
 
 
   // results from m
@@ -89,11 +259,23 @@ namespace emphasis {
     param_t estimates;
     int opt = -1;                       // nlopt result
     double minf = 0.0;
+    run_status_t status = run_status_t::completed;    // best estimate so far if not completed
     double elapsed = 0.0;               // elapsed runtime [ms]
   };
 
 
   using conditional_fun_t = std::function<double(const param_t&)>;
+
+
+  enum class m_optimizer_t
+  {
+    sbplx,        // nlopt subplex, sequential evaluations
+    mds           // multidirectional search, batches of evaluations in parallel
+  };
+
+
+  // "sbplx" or "mds"
+  m_optimizer_t make_m_optimizer(const std::string& name);
   
   
   M_step_t M_step(const param_t& pars,
@@ -104,7 +286,67 @@ namespace emphasis {
                   const param_t& upper_bound = {}, // overrides model.upper.bound
                   double xtol_rel = 0.001,
                   int num_threads = 0,
-                  conditional_fun_t* conditional = nullptr);
+                  conditional_fun_t* conditional = nullptr,
+                  m_optimizer_t optimizer = m_optimizer_t::sbplx,
+                  const deadline_t* deadline = nullptr,
+                  int minibatch = 0,                         // initial subsample size, 0: full sample only
+                  uint64_t seed = 0);                        // seeds the subsamples, 0: random
+
+
+  M_step_t M_step(const param_t& pars,
+                  const delta_trees& trees,                  // augmented trees, compact
+                  const std::vector<double>& weights,
+                  class Model* model,
+                  const param_t& lower_bound = {},
+                  const param_t& upper_bound = {},
+                  double xtol_rel = 0.001,
+                  int num_threads = 0,
+                  conditional_fun_t* conditional = nullptr,
+                  m_optimizer_t optimizer = m_optimizer_t::sbplx,
+                  const deadline_t* deadline = nullptr,
+                  int minibatch = 0,                         // initial subsample size, 0: full sample only
+                  uint64_t seed = 0);                        // seeds the subsamples, 0: random
+
+
+  M_step_t M_step(const param_t& pars,
+                  const replay_trees& trees,                 // augmented trees, regenerated
+                  const std::vector<double>& weights,
+                  class Model* model,
+                  const param_t& lower_bound = {},
+                  const param_t& upper_bound = {},
+                  double xtol_rel = 0.001,
+                  int num_threads = 0,
+                  conditional_fun_t* conditional = nullptr,
+                  m_optimizer_t optimizer = m_optimizer_t::sbplx,
+                  const deadline_t* deadline = nullptr,
+                  int minibatch = 0,                         // initial subsample size, 0: full sample only
+                  uint64_t seed = 0);                        // seeds the subsamples, 0: random
+
+
+  // M-step objective sum_i w_i loglik(pars_j, tree_i) at every parameter vector
+  // pars_j in one parallel pass, times conditional(pars_j) if given
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const std::vector<tree_t>& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional = nullptr,
+                                int num_threads = 0);
+
+
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const delta_trees& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional = nullptr,
+                                int num_threads = 0);
+
+
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const replay_trees& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional = nullptr,
+                                int num_threads = 0);
 
 
   // results from mcem
@@ -122,6 +364,10 @@ namespace emphasis {
   };
 
   
+  // With a pool, the pool takes over the trees of a fresh E-step and E refers
+  // to them (E_step_t::pooled); recycled samples refer to the pool unless
+  // trees were dropped. E remains valid as long as the pool isn't modified.
+  // The pool is only updated by iterations that completed the M-step.
   mcem_t mcem(int N,      // sample size
               int maxN,   // max. number of augmented trees (incl. invalid)
               const param_t& pars,
@@ -134,10 +380,232 @@ namespace emphasis {
               const param_t& upper_bound = {}, // overrides model.upper.bound
               double xtol_rel = 0.001,
               int num_threads = 0,
-              conditional_fun_t* conditional = nullptr);
+              conditional_fun_t* conditional = nullptr,
+              tree_pool_t* pool = nullptr,     // recycles trees if not null
+              double min_ess = 0.5,            // min. relative effective sample size of recycled trees
+              const sampler_control_t& sampler = {},
+              m_optimizer_t optimizer = m_optimizer_t::sbplx,
+              bool compact = false,            // compact tree storage
+              const deadline_t* deadline = nullptr,    // M-step skipped if the E-step was stopped
+              int minibatch = 0,               // see M_step
+              const prune_control_t& prune = {});      // applied after the tree pool was updated
+
+
+  // results from saem
+  struct saem_t
+  {
+    param_t estimates;                  // Polyak-Ruppert average after burn-in
+    std::vector<param_t> trace;         // M-step estimates per iteration
+    std::vector<double> fhat;           // E-step fhat per iteration
+    std::vector<double> gamma;          // step size per iteration
+    int iterations = 0;
+    bool converged = false;
+    size_t pool_size = 0;               // # trees in the final weighted pool
+    uint64_t seed = 0;                  // master seed of the E-step streams
+    run_status_t status = run_status_t::completed;    // estimates of the completed iterations if not completed
+    double elapsed = 0.0;               // elapsed runtime [ms]
+  };
+
+
+  // stochastic approximation EM.
+  // runs E-steps of fixed size N and maintains a weighted tree pool representing
+  // Q_k = (1 - gamma_k) Q_k-1 + gamma_k Q_hat_k with gamma_k = 1 during burn-in
+  // and (k - burnin)^-alpha thereafter. Converged once the batch-means standard
+  // error of the Polyak-Ruppert average, relative to the average, stays below tol.
+  // Reproducible for a given sampler.seed.
+  saem_t saem(int N,      // sample size per iteration
+              int maxN,   // max. number of augmented trees per iteration (incl. invalid)
+              const param_t& pars,
+              const brts_t& brts,
+              class Model* model,
+              int soc = 2,
+              int max_missing = default_max_missing_branches,
+              double max_lambda = default_max_aug_lambda,
+              const param_t& lower_bound = {}, // overrides model.lower_bound
+              const param_t& upper_bound = {}, // overrides model.upper.bound
+              double xtol_rel = 0.001,
+              int num_threads = 0,
+              conditional_fun_t* conditional = nullptr,
+              int burnin = 20,
+              int max_iterations = 500,
+              double alpha = 0.7,              // step size exponent, (0.5, 1]
+              double tol = 0.001,              // relative standard error of the averaged estimate
+              int patience = 5,                // # consecutive iterations below tol
+              int max_pool = 0,                // max. pool size, 0: 10 * N
+              const sampler_control_t& sampler = {},   // seed: master seed, no replay
+              bool compact = false,            // compact tree storage
+              const deadline_t* deadline = nullptr);   // checked per iteration and within E- and M-steps
+
+
+  // three-phase driver (burn-in, pilot, metaiterations)
+  struct fit_control_t
+  {
+    int burnin_sample_size = 200;
+    std::vector<int> pilot_sample_size = { 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000 };
+    int burnin_iterations = 20;
+    int pilot_burnin = 10;              // burn-in of the pilot chains
+    int meta_burnin = 2;                // burn-in of the metaiteration chains
+    double em_tol = 0.25;               // SE of fhat to stop a chain
+    double sample_size_tol = 0.005;
+    double recycle_ess = 0.0;           // see mcem, 0: no recycling
+    sampler_control_t sampler;
+    bool adapt_proposal = false;        // proposal tuned on the previous iteration, see adapt_proposal
+    m_optimizer_t optimizer = m_optimizer_t::sbplx;
+    bool compact = false;               // see mcem
+    int minibatch = 0;                  // see M_step
+    prune_control_t prune;              // see mcem
+    std::string checkpoint;             // checkpoint file, empty: none
+    int checkpoint_interval = 1;        // iterations between checkpoints
+    bool resume = false;                // continue from checkpoint if the file exists
+    int max_iterations = 10000;         // size of the history buffers
+  };
+
+
+  // iteration history of fit, preallocated
+  struct fit_history_t
+  {
+    fit_history_t() = default;
+    fit_history_t(int nparams, int capacity) : nparams(nparams)
+    {
+      pars.reserve(nparams * capacity);
+      fhat.reserve(capacity);
+      sample_size.reserve(capacity);
+      phase.reserve(capacity);
+    }
+
+    size_t size() const { return fhat.size(); }
+    bool full() const { return fhat.size() == fhat.capacity(); }
+    const double* row(size_t i) const { return pars.data() + i * nparams; }
+
+    void push_back(const param_t& p, double f, int n, int ph)
+    {
+      pars.insert(pars.end(), p.cbegin(), p.cend());
+      fhat.push_back(f);
+      sample_size.push_back(n);
+      phase.push_back(ph);
+    }
+
+    int nparams = 0;
+    std::vector<double> pars;           // row-major, nparams per iteration
+    std::vector<double> fhat;
+    std::vector<int> sample_size;
+    std::vector<int> phase;             // 1: burn-in, 2: pilot, 3: metaiteration
+  };
+
+
+  struct fit_progress_t
+  {
+    int phase;
+    int metaiteration;                  // phase 3
+    int iteration;                      // within the current chain
+    int sample_size;
+    int required_sample_size;           // phase 3
+    double fhat;
+    double sde;                         // SE of fhat, 0 during burn-in
+    const param_t& estimates;
+  };
+
+
+  using fit_callback_t = std::function<void(const fit_progress_t&)>;
+
+
+  // results from fit
+  struct fit_t
+  {
+    param_t estimates;
+    fit_history_t history;
+    int metaiterations = 0;
+    int required_sample_size = 0;
+    bool truncated = false;             // history buffers exhausted
+    run_status_t status = run_status_t::completed;
+    uint64_t seed = 0;                  // master seed of the E-step streams
+    int resumed = 0;                    // iterations replayed from the checkpoint
+    double elapsed = 0.0;               // elapsed runtime [ms]
+  };
+
+
+  fit_t fit(const param_t& pars,
+            const brts_t& brts,
+            class Model* model,
+            int soc = 2,
+            int max_missing = default_max_missing_branches,
+            double max_lambda = default_max_aug_lambda,
+            const param_t& lower_bound = {}, // overrides model.lower_bound
+            const param_t& upper_bound = {}, // overrides model.upper.bound
+            double xtol_rel = 0.001,
+            int num_threads = 0,
+            conditional_fun_t* conditional = nullptr,
+            const fit_control_t& control = {},
+            const fit_callback_t& callback = {},
+            const deadline_t* deadline = nullptr);
+
+
+  struct chains_control_t
+  {
+    int chains = 4;
+    double dispersion = 0.5;            // starting points pars + dispersion * max(|pars|, 0.01) * U(-1, 1), chain 0 at pars
+    int burnin = 5;                     // iterations per chain excluded from the diagnostics
+    int check_interval = 5;             // iterations between convergence checks
+    int max_iterations = 100;           // per chain
+    double max_rhat = 1.05;             // converged if the R-hat of fhat and of all parameters is below
+    sampler_control_t sampler;          // seed: master seed of the chains
+    m_optimizer_t optimizer = m_optimizer_t::sbplx;
+    bool compact = false;               // see mcem
+    int minibatch = 0;                  // see M_step
+    prune_control_t prune;              // see mcem
+  };
+
+
+  // results from mcem_chains. Estimates and diagnostics refer to the trailing
+  // half of the post burn-in iterations of each chain.
+  struct chains_t
+  {
+    param_t estimates;                  // pooled over the chains
+    param_t se;                         // Monte Carlo SE of the estimates, from the chain means
+    param_t rhat;                       // potential scale reduction factors
+    double fhat = 0.0;                  // pooled
+    double fhat_se = 0.0;
+    double fhat_rhat = 0.0;
+    std::vector<fit_history_t> history; // per chain, phase 1: burn-in, 3: thereafter
+    int iterations = 0;                 // per chain
+    bool converged = false;
+    uint64_t seed = 0;                  // master seed in use
+    run_status_t status = run_status_t::completed;
+    double elapsed = 0.0;               // elapsed runtime [ms]
+  };
+
+
+  // K independent mcem chains from dispersed starting points, run
+  // concurrently on one thread pool until the between-chain diagnostics 
+  // (Gelman-Rubin R-hat) signal convergence. Reproducible for a given seed.
+  chains_t mcem_chains(int N,      // sample size per iteration
+                       int maxN,   // max. number of augmented trees per iteration (incl. invalid)
+                       const param_t& pars,
+                       const brts_t& brts,
+                       class Model* model,
+                       int soc = 2,
+                       int max_missing = default_max_missing_branches,
+                       double max_lambda = default_max_aug_lambda,
+                       const param_t& lower_bound = {}, // overrides model.lower_bound
+                       const param_t& upper_bound = {}, // overrides model.upper.bound
+                       double xtol_rel = 0.001,
+                       int num_threads = 0,
+                       conditional_fun_t* conditional = nullptr,    // called concurrently
+                       const chains_control_t& control = {},
+                       const deadline_t* deadline = nullptr);
+
+
+  // isolated: a non-thread-safe plugin is loaded once per thread from private
+  // copies of model_dll and reports itself as thread-safe
+  std::unique_ptr<class Model> create_plugin_model(const std::string& model_dll, bool isolated = false);
+
+
+  namespace detail {
 
+    // per-thread private copies of model_dll, regardless of is_threadsafe
+    std::unique_ptr<class Model> create_isolated_plugin_model(const std::string& model_dll);
 
-  std::unique_ptr<class Model> create_plugin_model(const std::string& model_dll);
+  }
 
 }
 
@@ -0,0 +1,80 @@
+#ifndef EMPHASIS_ENVELOPE_CACHE_HPP_INCLUDED
+#define EMPHASIS_ENVELOPE_CACHE_HPP_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+
+namespace emphasis {
+
+  namespace detail {
+
+
+    // piecewise-constant upper bounds of the speciation rate ahead of cbt.
+    // A bound over [t0, t1] remains valid on every sub-range; rejected
+    // proposals keep using it until the tree changes. Pieces with poor
+    // acceptance are halved and re-bounded.
+    class envelope_cache
+    {
+      static constexpr int min_proposals = 4;
+      static constexpr int max_depth = 6;
+      static constexpr double min_acceptance = 0.5;
+
+    public:
+      struct piece_t
+      {
+        double t0, t1;
+        double bound;
+        double sum_pt;
+        int proposals;
+        int depth;
+      };
+
+      envelope_cache() { pieces_.reserve(max_depth + 1); }
+
+      // piece covering cbt, within the backbone interval [cbt, next_bt]
+      template <typename MAXIMIZE>
+      const piece_t& at(double cbt, double next_bt, MAXIMIZE&& maximize)
+      {
+        while (!pieces_.empty() && pieces_.back().t1 <= cbt) pieces_.pop_back();
+        if (pieces_.empty()) {
+          pieces_.push_back({ cbt, next_bt, maximize(cbt, next_bt), 0.0, 0, 0 });
+        }
+        else {
+          auto& p = pieces_.back();
+          if ((p.proposals >= min_proposals) && (p.sum_pt < min_acceptance * p.proposals) && (p.depth < max_depth)) {
+            // refine [cbt, t1]
+            const double t1 = p.t1;
+            const double tm = 0.5 * (cbt + t1);
+            const int depth = p.depth + 1;
+            pieces_.back() = { tm, t1, maximize(tm, t1), 0.0, 0, depth };
+            pieces_.push_back({ cbt, tm, maximize(cbt, tm), 0.0, 0, depth });
+          }
+        }
+        return pieces_.back();
+      }
+
+      // acceptance probability of a rejected proposal
+      void reject(double pt)
+      {
+        auto& p = pieces_.back();
+        p.sum_pt += pt;
+        ++p.proposals;
+      }
+
+      // tree changed at t: rates beyond t may depend on the new lineage
+      void invalidate(double t)
+      {
+        pieces_.erase(std::remove_if(pieces_.begin(), pieces_.end(), [t](const piece_t& p) { return p.t1 > t; }), pieces_.end());
+      }
+
+    private:
+      std::vector<piece_t> pieces_;   // back() is the piece ahead of cbt
+    };
+
+
+  }
+
+}
+
+#endif
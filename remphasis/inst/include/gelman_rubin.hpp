@@ -0,0 +1,53 @@
+#ifndef EMPHASIS_GELMAN_RUBIN_HPP_INCLUDED
+#define EMPHASIS_GELMAN_RUBIN_HPP_INCLUDED
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <numeric>
+
+
+namespace emphasis {
+
+  namespace detail {
+
+    struct diagnostic_t
+    {
+      double mean;
+      double se;
+      double rhat;
+    };
+
+
+    // Gelman-Rubin diagnostic of x(H[k], i) over the rows [first, last) of the chains H
+    template <typename CHAIN, typename X>
+    diagnostic_t gelman_rubin(const std::vector<CHAIN>& H, size_t first, size_t last, X&& x)
+    {
+      const double K = static_cast<double>(H.size());
+      const double n = static_cast<double>(last - first);
+      double W = 0.0;
+      std::vector<double> m;
+      for (const auto& h : H) {
+        double sum = 0.0;
+        for (size_t i = first; i < last; ++i) sum += x(h, i);
+        const double mean = sum / n;
+        double ss = 0.0;
+        for (size_t i = first; i < last; ++i) ss += (x(h, i) - mean) * (x(h, i) - mean);
+        W += ss / (n - 1.0);
+        m.push_back(mean);
+      }
+      W /= K;
+      const double mean = std::accumulate(m.cbegin(), m.cend(), 0.0) / K;
+      double B = 0.0;     // B / n
+      for (auto mk : m) B += (mk - mean) * (mk - mean);
+      B /= (K - 1.0);
+      const double var = (n - 1.0) / n * W + B;
+      const double rhat = (W > 0.0) ? std::sqrt(var / W) : ((B > 0.0) ? std::numeric_limits<double>::infinity() : 1.0);
+      return { mean, std::sqrt(B / K), rhat };
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef EMPHASIS_MAXIMIZE_1D_HPP_INCLUDED
+#define EMPHASIS_MAXIMIZE_1D_HPP_INCLUDED
+
+#include <cmath>
+#include <algorithm>
+
+
+#ifndef EMPHASIS_LAMBDA_MAX_EVALS
+#define EMPHASIS_LAMBDA_MAX_EVALS 24        // function evaluations per thinning bound
+#endif
+
+#ifndef EMPHASIS_LAMBDA_XTOL_REL
+#define EMPHASIS_LAMBDA_XTOL_REL 0.0001
+#endif
+
+#ifndef EMPHASIS_LAMBDA_SAFETY_MARGIN
+#define EMPHASIS_LAMBDA_SAFETY_MARGIN 0.01  // relative inflation of the thinning bound
+#endif
+
+
+namespace emphasis {
+
+  namespace detail {
+
+
+    // Brent's bounded maximization of f on [a, b], endpoints included.
+    // Returns the largest value seen, not the value at the final abscissa.
+    // At most max_evals calls to f, no allocations.
+    template <typename F>
+    inline double maximize_1d(F&& f, double a, double b, int max_evals, double xtol_rel)
+    {
+      constexpr double cgold = 0.3819660112501051;    // (3 - sqrt(5)) / 2
+      if (a > b) std::swap(a, b);
+      double best = std::max(f(a), f(b));
+      if (!(b > a) || (max_evals < 3)) return best;
+      // minimize -f
+      double x = a + cgold * (b - a);
+      double fx = -f(x);
+      best = std::max(best, -fx);
+      double w = x, fw = fx;
+      double v = x, fv = fx;
+      double d = 0.0, e = 0.0;
+      for (int evals = 3; evals < max_evals; ++evals) {
+        const double m = 0.5 * (a + b);
+        const double tol = xtol_rel * std::abs(x) + 1e-10;
+        const double tol2 = 2.0 * tol;
+        if (std::abs(x - m) <= tol2 - 0.5 * (b - a)) break;
+        double p = 0.0, q = 0.0, r = 0.0;
+        if (std::abs(e) > tol) {
+          // parabolic fit through x, w, v
+          r = (x - w) * (fx - fv);
+          q = (x - v) * (fx - fw);
+          p = (x - v) * q - (x - w) * r;
+          q = 2.0 * (q - r);
+          if (q > 0.0) p = -p; else q = -q;
+          r = e;
+          e = d;
+        }
+        if ((std::abs(p) < std::abs(0.5 * q * r)) && (p > q * (a - x)) && (p < q * (b - x))) {
+          d = p / q;
+          const double u = x + d;
+          if (((u - a) < tol2) || ((b - u) < tol2)) d = (x < m) ? tol : -tol;
+        }
+        else {
+          // golden section step into the larger segment
+          e = (x < m) ? b - x : a - x;
+          d = cgold * e;
+        }
+        const double u = (std::abs(d) >= tol) ? x + d : ((d > 0.0) ? x + tol : x - tol);
+        const double fu = -f(u);
+        best = std::max(best, -fu);
+        if (fu <= fx) {
+          if (u < x) b = x; else a = x;
+          v = w; fv = fw;
+          w = x; fw = fx;
+          x = u; fx = fu;
+        }
+        else {
+          if (u < x) a = u; else b = u;
+          if ((fu <= fw) || (w == x)) {
+            v = w; fv = fw;
+            w = u; fw = fu;
+          }
+          else if ((fu <= fv) || (v == x) || (v == w)) {
+            v = u; fv = fu;
+          }
+        }
+      }
+      return best;
+    }
+
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef EMPHASIS_MDS_HPP_INCLUDED
+#define EMPHASIS_MDS_HPP_INCLUDED
+
+#include <vector>
+#include <functional>
+#include <nlopt.h>
+
+
+namespace emphasis {
+
+
+  // multidirectional search (Torczon 1991), box constrained by projection.
+  // The reflection, expansion and contraction of the simplex are evaluated
+  // speculatively as one batch of 3 * nparams points per iteration.
+  class mds
+  {
+  public:
+    // evaluates the objective at the m points in x (row-major, m x nparams) into f
+    using batch_func = std::function<void(size_t m, const double* x, double* f)>;
+
+    mds(const mds&) = delete;
+    mds& operator=(const mds&) = delete;
+
+    explicit mds(size_t nparams);
+    void set_xtol_rel(double);
+    void set_lower_bounds(const std::vector<double>&);
+    void set_upper_bounds(const std::vector<double>&);
+    void set_maxeval(int);
+    void set_initial_step(double);             // relative to |x|, default 0.1
+    void set_min_objective(batch_func);
+    void set_stop(std::function<bool()>);     // checked per iteration, NLOPT_FORCED_STOP
+    double optimize(std::vector<double>&);
+    nlopt_result result();
+
+  private:
+    void project(double* x) const;
+    bool converged(const std::vector<double>& S) const;
+
+    size_t n_;
+    double xtol_rel_ = 0.0001;
+    int maxeval_ = 0;
+    double step_rel_ = 0.1;
+    std::vector<double> lower_, upper_;
+    batch_func f_;
+    std::function<bool()> stop_;
+    nlopt_result result_ = nlopt_result::NLOPT_FAILURE;
+  };
+
+}
+
+#endif
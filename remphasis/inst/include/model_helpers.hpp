@@ -34,6 +34,7 @@
 #include <thread>
 #include <numeric>
 #include <algorithm>
+#include <cstdint>
 #include "plugin.hpp"
 
 
@@ -133,18 +134,114 @@ namespace emphasis {
     };
 
 
+    // random variates
+    //
+    // All variates are generated from 64 bit engines by bit-conversion,
+    // thus independent of the standard library's distribution implementations.
+
+    using reng_t = std::mt19937_64;   // random engine used by the engine and plugins
+
+
+    // thread local random stream owned by this binary
+    inline void* local_random_stream()
+    {
+      static thread_local reng_t reng = make_random_engine<reng_t>();
+      return &reng;
+    }
+
+
+    // accessor to the random stream in use.
+    // The engine hands its accessor to plugins via emp_set_random_stream.
+    inline emp_random_stream_func& random_stream_accessor()
+    {
+      static emp_random_stream_func accessor = &local_random_stream;
+      return accessor;
+    }
+
+
+    // the calling thread's random stream
+    inline reng_t& random_stream()
+    {
+      return *static_cast<reng_t*>(random_stream_accessor()());
+    }
+
+
+    // maps 64 random bits to (0, 1]
+    inline double to_unit(uint64_t bits) noexcept
+    {
+      return static_cast<double>((bits >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+
+    // uniform variate in (0, 1]
+    template <typename RENG>
+    inline double uniform(RENG& reng)
+    {
+      static_assert(RENG::max() == std::numeric_limits<uint64_t>::max(), "64 bit engine required");
+      return to_unit(reng());
+    }
+
+
+    // fills [first, last) with uniform variates in (0, 1]
+    template <typename RENG>
+    inline void fill_uniform(double* first, double* last, RENG& reng)
+    {
+      for (; first != last; ++first) {
+        *first = uniform(reng);
+      }
+    }
+
+
+    // fills [first, last) with exponential variates
+    template <typename RENG>
+    inline void fill_exp(double rate, double* first, double* last, RENG& reng)
+    {
+      const double s = -1.0 / rate;
+      for (; first != last; ++first) {
+        *first = s * std::log(uniform(reng));
+      }
+    }
+
+
+    // exponential variate truncated to [0, upper].
+    // inverse cdf, constant time regardless of the truncation.
     template <typename RENG>
     inline double trunc_exp(double upper, double rate, RENG& reng)
     {
-      std::exponential_distribution<double> exp_dist(rate);
-      double result = exp_dist(reng);
-      while (result > upper) {
-        result = exp_dist(reng);
+      const double u = uniform(reng);
+      if (!(rate > 0.0)) {
+        return u * upper;   // limit rate -> 0
       }
-      return result;
+      return std::min(upper, -std::log1p(u * std::expm1(-rate * upper)) / rate);
     }
 
 
+    // block-wise buffered uniform variates
+    template <typename RENG, size_t N = 64>
+    class uniform_buffer
+    {
+    public:
+      explicit uniform_buffer(RENG& reng) : reng_(reng) {}
+
+      double operator()()
+      {
+        if (pos_ == N) {
+          fill_uniform(buf_.data(), buf_.data() + N, reng_);
+          pos_ = 0;
+        }
+        return buf_[pos_++];
+      }
+
+      // discards buffered variates
+      void reset() noexcept { pos_ = N; }
+
+    private:
+      RENG& reng_;
+      std::array<double, N> buf_;
+      size_t pos_ = N;
+    };
+
+
     // Int_0_t1 (1-exp(-mu*(tm-t)))
     class mu_integral
     {
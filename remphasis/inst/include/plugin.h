@@ -70,6 +70,32 @@ typedef double (*emp_sampling_prob_func)(const double*, unsigned, const emp_node
 typedef double (*emp_loglik_func)(const double*, unsigned, const emp_node_t*);
 
 
+/* optional fused loglik and sampling_prob: */
+/* returns loglik - sampling_prob, stores both terms in the last two arguments */
+typedef double (*emp_log_weight_func)(const double*, unsigned, const emp_node_t*, double*, double*);
+
+
+/* optional forward process for simulations: per-lineage speciation and */
+/* extinction rates at time t of n lineages with phylogenetic diversity pd */
+typedef void (*emp_bd_rates_func)(double, const double*, double, double, double*);
+
+
+/* optional per-augmentation state */
+/* the engine creates one state per augmentation and thread and tells the */
+/* state when the tree changed. Queries never go back beyond the cursor   */
+/* set by emp_advance_state before the next invalidation.                 */
+typedef void* (*emp_create_state_func)(const double*, unsigned, const emp_node_t*);
+typedef void (*emp_free_state_func)(void*);
+typedef void (*emp_invalidate_state_func)(void*, double, double);     /* tree changed in [t0, t1] */
+typedef void (*emp_advance_state_func)(void*, double, unsigned, const emp_node_t*);
+typedef double (*emp_nh_rate_state_func)(void*, double, const double*, unsigned, const emp_node_t*);
+
+
+/* optional random stream shared with the engine */
+typedef void* (*emp_random_stream_func)();   /* returns the calling thread's stream */
+typedef void (*emp_set_random_stream_func)(emp_random_stream_func);
+
+
 /* optional hints for optimizer */
 typedef void (*emp_lower_bound_func)(double*);
 typedef void (*emp_upper_bound_func)(double*);
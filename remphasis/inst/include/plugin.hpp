@@ -65,6 +65,25 @@ namespace emphasis {
     virtual double sampling_prob(const param_t& pars, const tree_t& tree) const = 0;
     virtual double loglik(const param_t& pars, const tree_t& tree) const = 0;
 
+    // optional single-pass loglik and sampling_prob, returns logf - logg
+    virtual double log_weight(const param_t& pars, const tree_t& tree, double& logf, double& logg) const
+    {
+      logf = loglik(pars, tree);
+      logg = sampling_prob(pars, tree);
+      return logf - logg;
+    }
+
+    // optional forward process, per-lineage speciation and extinction rates
+    // of n lineages with phylogenetic diversity pd at time t.
+    // Returns false if the model doesn't provide the forward process.
+    virtual bool bd_rates(double /*t*/, const param_t& /*pars*/, double /*n*/, double /*pd*/, double* /*rates*/) const { return false; }
+
+    // optional per-augmentation state, owned by state_guard
+    virtual double nh_rate_state(void** /*state*/, double t, const param_t& pars, const tree_t& tree) const { return nh_rate(t, pars, tree); }
+    virtual void advance_state(void** /*state*/, double /*t*/, const tree_t& /*tree*/) const {}
+    virtual void invalidate_state(void** /*state*/, double /*t0*/, double /*t1*/) const {}
+    virtual void free_state(void** state) const { *state = nullptr; }
+
     // optional hints for optimization step
     virtual param_t lower_bound() const { return param_t(); }
     virtual param_t upper_bound() const { return param_t(); }
@@ -0,0 +1,111 @@
+#ifndef EMPHASIS_PROPOSAL_HPP_INCLUDED
+#define EMPHASIS_PROPOSAL_HPP_INCLUDED
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "emphasis.hpp"
+#include "qmc.hpp"
+
+
+namespace emphasis {
+
+  namespace detail {
+
+    // log(exp(a) + exp(b))
+    inline double log_add_exp(double a, double b)
+    {
+      if (a < b) std::swap(a, b);
+      if (b == -std::numeric_limits<double>::infinity()) return a;
+      return a + std::log1p(std::exp(b - a));
+    }
+
+
+    // mixture proposal of the augmentation sampler, see proposal_t.
+    // Component 0 is the defensive component if the target is mixed in.
+    class mixture_proposal
+    {
+    public:
+      mixture_proposal(const param_t& target, const proposal_t& proposal, uint64_t seed)
+      : target_(target), seed_(stream_seed(seed, uint64_t(1) << 40))
+      {
+        if (proposal.pars.empty()) {
+          add(target, 1.0);
+          return;
+        }
+        const auto& w = proposal.weights;
+        if (!w.empty() && (w.size() != proposal.pars.size())) {
+          throw emphasis_error("proposal: size of weights doesn't match the components");
+        }
+        if (!(proposal.defensive >= 0.0) || !(proposal.defensive < 1.0)) {
+          throw emphasis_error("proposal: defensive weight must be in [0, 1)");
+        }
+        const double sum_w = w.empty() ? static_cast<double>(proposal.pars.size()) : std::accumulate(w.cbegin(), w.cend(), 0.0);
+        if (!(sum_w > 0.0) || std::any_of(w.cbegin(), w.cend(), [](double x) { return !(x >= 0.0); })) {
+          throw emphasis_error("proposal: invalid weights");
+        }
+        if (proposal.defensive > 0.0) {
+          add(target, proposal.defensive);
+        }
+        for (size_t k = 0; k < proposal.pars.size(); ++k) {
+          if (proposal.pars[k].size() != target.size()) {
+            throw emphasis_error("proposal: component of wrong size");
+          }
+          add(proposal.pars[k], (1.0 - proposal.defensive) * (w.empty() ? 1.0 : w[k]) / sum_w);
+        }
+        cum_.back() = 1.0;
+      }
+
+      // parameters of the component that augments i
+      const param_t& component(unsigned i) const
+      {
+        if (pars_.size() == 1) return pars_.front();
+        const double u = static_cast<double>(stream_seed(seed_, i) >> 11) * (1.0 / 9007199254740992.0);
+        const auto k = std::upper_bound(cum_.cbegin(), cum_.cend(), u) - cum_.cbegin();
+        return pars_[std::min(static_cast<size_t>(k), pars_.size() - 1)];
+      }
+
+      // log importance weight of tree, logg is the log mixture density
+      double log_weight(const Model* model, const tree_t& tree, double& logf, double& logg) const
+      {
+        size_t k = 0;
+        logg = -std::numeric_limits<double>::infinity();
+        if (pars_.front() == target_) {
+          // single pass for the target
+          double g0 = 0.0;
+          model->log_weight(target_, tree, logf, g0);
+          logg = log_alpha_.front() + g0;
+          k = 1;
+        }
+        else {
+          logf = model->loglik(target_, tree);
+        }
+        for (; k < pars_.size(); ++k) {
+          logg = log_add_exp(logg, log_alpha_[k] + model->sampling_prob(pars_[k], tree));
+        }
+        return logf - logg;
+      }
+
+    private:
+      void add(const param_t& pars, double alpha)
+      {
+        if (alpha <= 0.0) return;
+        pars_.push_back(pars);
+        log_alpha_.push_back(std::log(alpha));
+        cum_.push_back((cum_.empty() ? 0.0 : cum_.back()) + alpha);
+      }
+
+      param_t target_;
+      uint64_t seed_;
+      std::vector<param_t> pars_;
+      std::vector<double> log_alpha_;
+      std::vector<double> cum_;         // cumulative weights
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef EMPHASIS_QMC_HPP_INCLUDED
+#define EMPHASIS_QMC_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include <array>
+
+
+namespace emphasis {
+
+  namespace detail {
+
+    // splitmix64, used to derive independent seeds
+    inline uint64_t splitmix64(uint64_t& state) noexcept
+    {
+      uint64_t z = (state += 0x9e3779b97f4a7c15);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      return z ^ (z >> 31);
+    }
+
+
+    // seed of the random stream with index idx within the family of streams seed
+    inline uint64_t stream_seed(uint64_t seed, uint64_t idx) noexcept
+    {
+      uint64_t state = seed ^ splitmix64(idx);
+      return splitmix64(state);
+    }
+
+
+    // randomized (linear matrix scrambling + digital shift) Sobol' sequence.
+    // Direction numbers are derived from the first primitive polynomials over GF(2)
+    // with fixed odd initial values; any such choice yields a (t,s)-sequence.
+    class sobol
+    {
+    public:
+      static constexpr unsigned bits = 32;
+
+      sobol(unsigned dims, uint64_t seed) : dims_(dims), v_(dims), shift_(dims)
+      {
+        const auto polys = primitive_polynomials(dims);
+        uint64_t state = 0x2545f4914f6cdd1d;    // fixed initial direction numbers
+        for (unsigned d = 0; d < dims; ++d) {
+          std::array<uint32_t, bits> m{};
+          if (d == 0) {
+            m.fill(1);                          // van der Corput
+          }
+          else {
+            const uint32_t p = polys[d - 1];
+            const unsigned s = degree(p);
+            for (unsigned k = 0; k < s; ++k) {
+              m[k] = static_cast<uint32_t>(splitmix64(state) % (1u << k)) | 1u;
+            }
+            for (unsigned k = s; k < bits; ++k) {
+              uint32_t mk = m[k - s] ^ (m[k - s] << s);
+              for (unsigned j = 1; j < s; ++j) {
+                if ((p >> (s - j)) & 1u) mk ^= m[k - j] << j;
+              }
+              m[k] = mk;
+            }
+          }
+          for (unsigned k = 0; k < bits; ++k) {
+            v_[d][k] = m[k] << (bits - 1 - k);
+          }
+        }
+        scramble(seed);
+      }
+
+      unsigned dims() const noexcept { return dims_; }
+
+      // coordinate dim of point idx in (0, 1)
+      double operator()(uint32_t idx, unsigned dim) const noexcept
+      {
+        uint32_t x = shift_[dim];
+        const auto& v = v_[dim];
+        for (unsigned k = 0; idx; idx >>= 1, ++k) {
+          if (idx & 1u) x ^= v[k];
+        }
+        return (static_cast<double>(x) + 0.5) * (1.0 / 4294967296.0);
+      }
+
+    private:
+      static unsigned degree(uint32_t p) noexcept
+      {
+        unsigned d = 0;
+        while (p >>= 1) ++d;
+        return d;
+      }
+
+      // a * b mod p over GF(2)
+      static uint32_t mulmod(uint32_t a, uint32_t b, uint32_t p) noexcept
+      {
+        const unsigned s = degree(p);
+        uint32_t r = 0;
+        for (; b; b >>= 1) {
+          if (b & 1u) r ^= a;
+          a <<= 1;
+          if ((a >> s) & 1u) a ^= p;
+        }
+        return r;
+      }
+
+      static uint32_t powmod(uint32_t e, uint32_t p) noexcept
+      {
+        uint32_t r = 1, x = 2;
+        for (; e; e >>= 1) {
+          if (e & 1u) r = mulmod(r, x, p);
+          x = mulmod(x, x, p);
+        }
+        return r;
+      }
+
+      static bool is_primitive(uint32_t p) noexcept
+      {
+        const uint32_t order = (1u << degree(p)) - 1;
+        if (powmod(order, p) != 1) return false;
+        uint32_t n = order;
+        for (uint32_t q = 2; q * q <= n; ++q) {
+          if (n % q) continue;
+          if (powmod(order / q, p) == 1) return false;
+          while (0 == n % q) n /= q;
+        }
+        return (n == 1) || (powmod(order / n, p) != 1);
+      }
+
+      static std::vector<uint32_t> primitive_polynomials(unsigned n)
+      {
+        std::vector<uint32_t> polys;
+        for (uint32_t p = 3; polys.size() + 1 < n; p += 2) {
+          if (is_primitive(p)) polys.push_back(p);
+        }
+        return polys;
+      }
+
+      // Matousek's linear matrix scrambling and random digital shift
+      void scramble(uint64_t seed)
+      {
+        uint64_t state = seed;
+        for (unsigned d = 0; d < dims_; ++d) {
+          std::array<uint32_t, bits> L;
+          for (unsigned i = 0; i < bits; ++i) {
+            // row i: unit diagonal at digit i, random above (more significant digits)
+            const uint32_t diag = 1u << (bits - 1 - i);
+            const uint32_t upper = (i == 0) ? 0u : ~((diag << 1) - 1);
+            L[i] = diag | (static_cast<uint32_t>(splitmix64(state)) & upper);
+          }
+          for (unsigned k = 0; k < bits; ++k) {
+            uint32_t sv = 0;
+            for (unsigned i = 0; i < bits; ++i) {
+              sv |= static_cast<uint32_t>(parity(L[i] & v_[d][k])) << (bits - 1 - i);
+            }
+            v_[d][k] = sv;
+          }
+          shift_[d] = static_cast<uint32_t>(splitmix64(state));
+        }
+      }
+
+      static unsigned parity(uint32_t x) noexcept
+      {
+        x ^= x >> 16; x ^= x >> 8; x ^= x >> 4; x ^= x >> 2; x ^= x >> 1;
+        return x & 1u;
+      }
+
+      unsigned dims_;
+      std::vector<std::array<uint32_t, bits>> v_;
+      std::vector<uint32_t> shift_;
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef EMPHASIS_REPLAY_TREE_HPP_INCLUDED
+#define EMPHASIS_REPLAY_TREE_HPP_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "plugin.hpp"
+
+
+namespace emphasis {
+
+  namespace detail {
+
+    // regenerates accepted augmentations from their sampler streams, see E_step
+    class replay_source
+    {
+    public:
+      virtual ~replay_source() = default;
+      virtual const tree_t& backbone() const = 0;
+      virtual void augment(unsigned i, tree_t& out) const = 0;    // augmentation i into out
+    };
+
+  }
+
+
+  // augmented trees stored as augmentation indices (seed-replay).
+  // Trees are regenerated on access; the first cache trees are kept after their
+  // first regeneration. The source refers to the model of the E-step, which
+  // must outlive the trees.
+  class replay_trees
+  {
+  public:
+    replay_trees() = default;
+    replay_trees(std::shared_ptr<const detail::replay_source> source, size_t cache)
+    : source_(std::move(source)), cache_size_(cache), cache_(cache ? new slot_t[cache] : nullptr)
+    {
+    }
+
+    // the cache isn't copied
+    replay_trees(const replay_trees& other) : replay_trees(other.source_, other.cache_size_)
+    {
+      index_ = other.index_;
+    }
+
+    replay_trees& operator=(const replay_trees& other)
+    {
+      if (this != &other) {
+        *this = replay_trees(other);
+      }
+      return *this;
+    }
+
+    replay_trees(replay_trees&&) = default;
+    replay_trees& operator=(replay_trees&&) = default;
+
+    size_t size() const noexcept { return index_.size(); }
+    bool empty() const noexcept { return index_.empty(); }
+    const std::shared_ptr<const detail::replay_source>& source() const noexcept { return source_; }
+    const tree_t& backbone() const { return source_->backbone(); }
+    size_t cache() const noexcept { return cache_size_; }
+
+    // augmentation index of tree i
+    unsigned stream(size_t i) const noexcept { return index_[i]; }
+
+    // stored bytes, cached trees included
+    size_t bytes() const noexcept
+    {
+      size_t b = sizeof(unsigned) * index_.size() + sizeof(slot_t) * cache_size_;
+      for (size_t i = 0; i < cache_size_; ++i) {
+        if (cache_[i].state.load(std::memory_order_acquire) == ready) {
+          b += sizeof(node_t) * cache_[i].tree.capacity();
+        }
+      }
+      return b;
+    }
+
+    void reserve(size_t trees) { index_.reserve(trees); }
+
+    // not concurrent with at()
+    void push_back(unsigned i) { index_.push_back(i); }
+    void push_back(const replay_trees& other, size_t i) { index_.push_back(other.index_[i]); }
+
+    // tree i, regenerated into scratch unless cached
+    const tree_t& at(size_t i, tree_t& scratch) const
+    {
+      if (i < cache_size_) {
+        auto& slot = cache_[i];
+        unsigned char state = slot.state.load(std::memory_order_acquire);
+        if (state == ready) return slot.tree;
+        if ((state == vacant) && slot.state.compare_exchange_strong(state, filling, std::memory_order_acquire)) {
+          source_->augment(index_[i], slot.tree);
+          slot.state.store(ready, std::memory_order_release);
+          return slot.tree;
+        }
+      }
+      source_->augment(index_[i], scratch);
+      return scratch;
+    }
+
+    void expand(size_t i, tree_t& out) const
+    {
+      const tree_t& tree = at(i, out);
+      if (&tree != &out) out = tree;
+    }
+
+  private:
+    enum : unsigned char { vacant = 0, filling, ready };
+
+    struct slot_t
+    {
+      std::atomic<unsigned char> state{ vacant };
+      tree_t tree;
+    };
+
+    std::shared_ptr<const detail::replay_source> source_;
+    std::vector<unsigned> index_;
+    size_t cache_size_ = 0;
+    std::unique_ptr<slot_t[]> cache_;
+  };
+
+
+  namespace detail {
+
+    inline const tree_t& tree_at(const replay_trees& trees, size_t i, tree_t& scratch)
+    {
+      return trees.at(i, scratch);
+    }
+
+  }
+
+}
+
+#endif
@@ -9,29 +9,6 @@
 namespace emphasis {
 
 
-  class sbplx_1
-  {
-  public:
-    sbplx_1(const sbplx_1&) = delete;
-    sbplx_1& operator=(const sbplx_1&) = delete;
-
-    sbplx_1();
-    ~sbplx_1();
-    void set_xtol_rel(double);
-    void set_lower_bounds(double);
-    void set_upper_bounds(double);
-    void set_min_objective(nlopt_func, void*);
-    void set_max_objective(nlopt_func, void*);
-    double optimize(double&);
-    nlopt_result result();
-
-  private:
-    nlopt_opt nlopt_ = nullptr;
-    nlopt_result result_ = nlopt_result::NLOPT_FAILURE;
-    double lower_, upper_;
-  };
-
-
   class sbplx
   {
   public:
@@ -43,9 +20,11 @@ namespace emphasis {
     void set_xtol_rel(double);
     void set_lower_bounds(const std::vector<double>&);
     void set_upper_bounds(const std::vector<double>&);
+    void set_initial_step(const std::vector<double>&);
     void set_min_objective(nlopt_func, void*);
     void set_max_objective(nlopt_func, void*);
     double optimize(std::vector<double>&);
+    void force_stop();      // from within the objective
     nlopt_result result();
 
   private:
@@ -19,7 +19,8 @@ namespace emphasis {
 
     ~state_guard() { model_->free_state(&state_); }
     operator void** () noexcept { return &state_; }
-    void invalidate_state() { model_->invalidate_state(&state_); }
+    void invalidate_state(double t0, double t1) { model_->invalidate_state(&state_, t0, t1); }
+    void advance(double t, const tree_t& tree) { model_->advance_state(&state_, t, tree); }
 
   private:
     const Model* model_;
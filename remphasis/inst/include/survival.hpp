@@ -0,0 +1,53 @@
+#ifndef EMPHASIS_SURVIVAL_HPP_INCLUDED
+#define EMPHASIS_SURVIVAL_HPP_INCLUDED
+
+#include <vector>
+#include "emphasis.hpp"
+#include "conditional_grid.hpp"
+
+
+namespace emphasis {
+
+
+  struct survival_control_t
+  {
+    int simulations = 10000;            // per parameter vector
+    int max_lineages = 1000;            // simulations reaching max_lineages count as survived
+    uint64_t seed = 0;                  // 0: random seed. Streams are shared across parameter vectors
+  };
+
+
+  // P(survival | pars, age) from forward simulations of the model's
+  // birth-death process (Model::bd_rates), one per parameter vector.
+  // soc 2: both crown lineages leave descendants, soc 1: the stem lineage does.
+  std::vector<double> survival_prob(const std::vector<param_t>& pars,
+                                    double age,
+                                    class Model* model,
+                                    int soc = 2,
+                                    const survival_control_t& control = {},
+                                    int num_threads = 0);
+
+
+  // survival_prob tabulated on a grid over [lower, upper], n points per parameter.
+  // All grid points are simulated in one parallel batch.
+  conditional_grid survival_grid(const param_t& lower,
+                                 const param_t& upper,
+                                 const std::vector<int>& n,
+                                 double age,
+                                 class Model* model,
+                                 int soc = 2,
+                                 const survival_control_t& control = {},
+                                 int num_threads = 0);
+
+
+  // conditional for the M-step, simulated on demand with common random numbers.
+  // model must outlive the returned function.
+  conditional_fun_t survival_conditional(double age,
+                                         class Model* model,
+                                         int soc = 2,
+                                         const survival_control_t& control = {},
+                                         int num_threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef EMPHASIS_WEIGHTS_HPP_INCLUDED
+#define EMPHASIS_WEIGHTS_HPP_INCLUDED
+
+#include <cmath>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+
+
+namespace emphasis {
+
+  namespace detail {
+
+    // replaces log-weights by exp(log_w - max(log_w)).
+    // returns max(log_w)
+    inline double normalize_log_weights(std::vector<double>& w)
+    {
+      if (w.empty()) return 0.0;
+      const double max_log_w = *std::max_element(w.cbegin(), w.cend());
+      for (auto& x : w) {
+        x = std::exp(x - max_log_w);
+      }
+      return max_log_w;
+    }
+
+
+    // (sum w)^2 / sum w^2
+    inline double effective_sample_size(const std::vector<double>& w)
+    {
+      double sw = 0.0;
+      double sw2 = 0.0;
+      for (const auto x : w) {
+        sw += x;
+        sw2 += x * x;
+      }
+      return (sw2 > 0.0) ? (sw * sw) / sw2 : 0.0;
+    }
+
+
+    // systematic PPS resample of m draws, stratified by weight.
+    // u in [0, 1) is the random offset of the draws within their strata.
+    // index: drawn elements in ascending order, sw: k * sum(w) / m for k draws.
+    inline void systematic_resample(const std::vector<double>& w, size_t m, double u, std::vector<size_t>& index, std::vector<double>& sw)
+    {
+      index.clear();
+      sw.clear();
+      if (w.empty() || (m == 0)) return;
+      std::vector<size_t> order(w.size());
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return w[a] > w[b]; });
+      const double step = std::accumulate(w.cbegin(), w.cend(), 0.0) / static_cast<double>(m);
+      std::vector<std::pair<size_t, double>> drawn;
+      double cum = 0.0;
+      double next = u * step;
+      for (size_t i : order) {
+        cum += w[i];
+        double hits = 0.0;
+        for (; next < cum; next += step) hits += 1.0;
+        if (hits > 0.0) drawn.emplace_back(i, hits * step);
+      }
+      std::sort(drawn.begin(), drawn.end());
+      for (const auto& d : drawn) {
+        index.push_back(d.first);
+        sw.push_back(d.second);
+      }
+    }
+
+  }
+
+}
+
+#endif
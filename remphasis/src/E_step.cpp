@@ -2,11 +2,15 @@
 #include <atomic>
 #include <algorithm>
 #include <numeric>
+#include <iterator>
 #include <tbb/tbb.h>
 #include "emphasis.hpp"
 #include "augment_tree.hpp"
 #include "plugin.hpp"
 #include "model_helpers.hpp"
+#include "weights.hpp"
+#include "qmc.hpp"
+#include "proposal.hpp"
 
 
 namespace emphasis {
@@ -35,6 +39,492 @@ namespace emphasis {
       return(tree);
     }
 
+
+    constexpr unsigned qmc_dims = 64;    // pseudo-random uniforms beyond
+    constexpr uint64_t prune_stream = uint64_t(1) << 41;   // stream of the prune offset, beyond the augmentations
+
+
+    // maps augmentation index to sampler streams.
+    // Augmentation i belongs to replicate i % R; every replicate is an independent
+    // randomization of the sampler.
+    class sampler_streams
+    {
+    public:
+      sampler_streams(const sampler_control_t& control)
+      : type_(control.type),
+        R_(static_cast<unsigned>(std::max(1, control.replicates))),
+        seed_(control.seed)
+      {
+        if (seed_ == 0) {
+          seed_ = make_random_engine<reng_t>()();
+        }
+        if (type_ == sampler_t::sobol) {
+          for (unsigned r = 0; r < R_; ++r) {
+            qmc_.emplace_back(qmc_dims, stream_seed(seed_, ~uint64_t(r)));
+          }
+        }
+      }
+
+      unsigned replicates() const noexcept { return R_; }
+      uint64_t seed() const noexcept { return seed_; }
+      unsigned replicate(unsigned i) const noexcept { return i % R_; }
+
+      augment_stream_t operator()(unsigned i) const
+      {
+        const unsigned r = replicate(i);
+        const unsigned k = i / R_;    // index within replicate
+        augment_stream_t stream{ stream_seed(seed_, i) };
+        switch (type_) {
+          case sampler_t::sobol:
+            stream.qmc = &qmc_[r];
+            stream.point = k;
+            break;
+          case sampler_t::antithetic:
+            stream.seed = stream_seed(seed_, (k & ~1u) * R_ + r);    // shared by the pair
+            stream.antithetic = (k & 1u);
+            break;
+          default:
+            break;
+        }
+        return stream;
+      }
+
+    private:
+      sampler_t type_;
+      unsigned R_;
+      uint64_t seed_;
+      std::vector<sobol> qmc_;
+    };
+
+
+    // regenerates the accepted augmentations of an E-step
+    class augmentation_replay : public replay_source
+    {
+    public:
+      augmentation_replay(const param_t& pars,
+                          const sampler_control_t& sampler,     // seed required
+                          const tree_t& init_tree,
+                          Model* model,
+                          int max_missing,
+                          double max_lambda)
+      : streams_(sampler), proposal_(pars, sampler.proposal, streams_.seed()), init_tree_(init_tree), 
+        model_(model), max_missing_(max_missing), max_lambda_(max_lambda), pars_(pars), sampler_(sampler)
+      {
+      }
+
+      const tree_t& backbone() const override { return init_tree_; }
+
+      replay_spec_t spec() const
+      {
+        return replay_spec_t{ pars_, sampler_, init_tree_, max_missing_, max_lambda_, {} };
+      }
+
+      void augment(unsigned i, tree_t& out) const override
+      {
+        const auto res = emphasis::augment_tree(proposal_.component(i), init_tree_, model_, max_missing_, max_lambda_, out, streams_(i));
+        if (res.status != augment_status_t::accepted) {
+          throw emphasis_error("replay: augmentation not reproduced");
+        }
+      }
+
+    private:
+      const sampler_streams streams_;
+      const mixture_proposal proposal_;
+      const tree_t init_tree_;
+      Model* model_;
+      int max_missing_;
+      double max_lambda_;
+      const param_t pars_;
+      const sampler_control_t sampler_;
+    };
+
+
+    // variance of fhat = log(mean weight) from the replicate means (delta method)
+    double fhat_variance(const std::vector<double>& sum_w, const std::vector<int>& count)
+    {
+      std::vector<double> m;
+      for (size_t r = 0; r < sum_w.size(); ++r) {
+        if (count[r]) m.push_back(sum_w[r] / count[r]);
+      }
+      if (m.size() < 2) return 0.0;
+      const double R = static_cast<double>(m.size());
+      const double mean = std::accumulate(m.cbegin(), m.cend(), 0.0) / R;
+      double ss = 0.0;
+      for (auto x : m) ss += (x - mean) * (x - mean);
+      return (mean > 0.0) ? ss / (R * (R - 1.0) * mean * mean) : 0.0;
+    }
+
+
+    // outcome of augmentation i, ordered E-steps
+    enum augmentation_outcome : unsigned char
+    {
+      pending = 0,
+      accepted,
+      overrun,
+      lambda,
+      zero_weight
+    };
+
+
+    template <typename T>
+    void apply_order(std::vector<T>& v, const std::vector<size_t>& order)
+    {
+      if (v.empty()) return;
+      std::vector<T> tmp;
+      tmp.reserve(order.size());
+      for (auto i : order) tmp.emplace_back(std::move(v[i]));
+      v.swap(tmp);
+    }
+
+
+    // sorts the accepted trees by augmentation index and keeps the first n
+    void sort_by_index(size_t n, std::vector<unsigned>& index, E_step_t& E)
+    {
+      std::vector<size_t> order(index.size());
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return index[a] < index[b]; });
+      if (order.size() > n) order.resize(n);
+      if (!E.deltas.empty()) {
+        delta_trees deltas(E.deltas.backbone());
+        deltas.reserve(order.size(), 0);
+        for (auto i : order) deltas.push_back(E.deltas, i);
+        E.deltas = std::move(deltas);
+      }
+      if (!E.replay.empty()) {
+        replay_trees replay(E.replay.source(), E.replay.cache());
+        replay.reserve(order.size());
+        for (auto i : order) replay.push_back(E.replay, i);
+        E.replay = std::move(replay);
+      }
+      apply_order(E.trees, order);
+      apply_order(E.weights, order);
+      apply_order(E.logf, order);
+      apply_order(E.logg, order);
+      apply_order(index, order);
+    }
+
+
+    // rejection counts and times of the augmentations [0, processed) from their outcomes
+    template <typename REPLICATE>
+    void count_outcomes(unsigned processed, const std::vector<unsigned char>& outcome, const std::vector<float>& reject_time, std::vector<int>& attempts, REPLICATE&& replicate, E_step_t& E)
+    {
+      E.rejected_overruns = E.rejected_lambda = E.rejected_zero_weights = 0;
+      E.overrun_times.clear();
+      E.lambda_times.clear();
+      std::fill(attempts.begin(), attempts.end(), 0);
+      for (unsigned i = 0; i < processed; ++i) {
+        switch (outcome[i]) {
+          case overrun: 
+            ++E.rejected_overruns; 
+            E.overrun_times.push_back(reject_time[i]);
+            break;
+          case lambda: 
+            ++E.rejected_lambda; 
+            E.lambda_times.push_back(reject_time[i]);
+            break;
+          case zero_weight: ++E.rejected_zero_weights; break;
+          case pending: continue;
+          default: break;
+        }
+        ++attempts[replicate(i)];
+      }
+    }
+
+
+    // keeps the first N accepted trees by augmentation index and recounts the
+    // rejections up to the last kept index
+    template <typename REPLICATE>
+    void select_first(int N, unsigned processed, const std::vector<unsigned char>& outcome, const std::vector<float>& reject_time, std::vector<unsigned>& index, std::vector<int>& attempts, REPLICATE&& replicate, E_step_t& E)
+    {
+      sort_by_index(static_cast<size_t>(N), index, E);
+      if (index.size() == static_cast<size_t>(N)) {
+        processed = std::min(processed, index.back() + 1);
+      }
+      count_outcomes(processed, outcome, reject_time, attempts, replicate, E);
+    }
+
+
+    // per-thread rejection counts and attempts
+    struct tally_t
+    {
+      explicit tally_t(unsigned replicates) : attempts(replicates, 0) {}
+
+      int overruns = 0;
+      int lambda = 0;
+      int zero_weights = 0;
+      std::vector<int> attempts;
+      std::vector<double> overrun_times;
+      std::vector<double> lambda_times;
+    };
+
+
+    // runs augmentations into E.
+    // E.weights receives unnormalized log-weights. Rejections are tallied 
+    // per thread, only accepted trees take the lock.
+    class augmenter
+    {
+    public:
+      augmenter(const param_t& pars,
+                const brts_t& brts,
+                Model* model,
+                int soc,
+                int max_missing,
+                double max_lambda,
+                const sampler_control_t& sampler,
+                bool compact,
+                bool ordered,
+                const deadline_t* deadline,
+                E_step_t& E)
+      : streams(sampler), attempts(streams.replicates(), 0),
+        proposal_(pars, sampler.proposal, streams.seed()), model_(model), max_missing_(max_missing), max_lambda_(max_lambda),
+        compact_(compact), replay_(sampler.replay), ordered_(ordered), deadline_(deadline), E_(E),
+        tally_([R = streams.replicates()]() { return tally_t(R); })
+      {
+        init_tree_ = create_tree(brts, static_cast<double>(soc));
+        age_ = init_tree_.back().brts;
+        if (replay_) {
+          auto replay_sampler = sampler;
+          replay_sampler.seed = streams.seed();
+          auto source = std::make_shared<augmentation_replay>(pars, replay_sampler, init_tree_, model, max_missing, max_lambda);
+          E_.replay = replay_trees(std::move(source), static_cast<size_t>(std::max(0, sampler.replay_cache)));
+        }
+        else if (compact) {
+          E_.deltas = delta_trees(init_tree_);
+        }
+        E_.seed = streams.seed();
+      }
+
+      bool stopped() const noexcept { return stop_; }
+
+      // augmentations [first, end); unordered runs stop at N accepted trees
+      void run(unsigned first, unsigned end, int N)
+      {
+        if (ordered_) {
+          outcome.resize(end - base, pending);
+          reject_time.resize(end - base, 0.f);
+        }
+        tbb::parallel_for(tbb::blocked_range<unsigned>(first, end), [&](const tbb::blocked_range<unsigned>& r) {
+          auto& T = tally_.local();
+          for (unsigned i = r.begin(); (i < r.end()) && !stop_; ++i) {
+            // reuse tree from pool
+            auto& pool_tree = pooled_tree;
+            const auto res = emphasis::augment_tree(proposal_.component(i), init_tree_, model_, max_missing_, max_lambda_, pool_tree, streams(i), deadline_);
+            switch (res.status) {
+              case augment_status_t::cancelled: 
+                stop_ = true; 
+                continue;
+              case augment_status_t::overrun: 
+                reject(T, i, overrun, res.t / age_); 
+                continue;
+              case augment_status_t::lambda: 
+                reject(T, i, lambda, res.t / age_); 
+                continue;
+              default: 
+                break;
+            }
+            double logf = 0.0;
+            double logg = 0.0;
+            const double log_w = proposal_.log_weight(model_, pool_tree, logf, logg);
+            if (!(std::isfinite(log_w) && (0.0 < std::exp(log_w)))) {
+              reject(T, i, zero_weight, 1.0);
+              continue;
+            }
+            std::lock_guard<std::mutex> _(mutex_);
+            if (!stop_) {
+              if (ordered_) outcome[i - base] = accepted;
+              ++T.attempts[streams.replicate(i)];
+              index.push_back(i);
+              if (replay_) {
+                E_.replay.push_back(i);
+              }
+              else if (compact_) {
+                E_.deltas.push_back(pool_tree);
+              }
+              else {
+                E_.trees.emplace_back(pool_tree.cbegin(), pool_tree.cend());
+              }
+              E_.weights.push_back(log_w);
+              E_.logf.push_back(logf);
+              E_.logg.push_back(logg);
+              if (!ordered_ && (static_cast<int>(E_.weights.size()) == N)) {
+                stop_ = true;
+              }
+            }
+          }
+        });
+      }
+
+      // adds the tallies of the runs to E and attempts
+      void tally()
+      {
+        tally_.combine_each([&](const tally_t& T) {
+          E_.rejected_overruns += T.overruns;
+          E_.rejected_lambda += T.lambda;
+          E_.rejected_zero_weights += T.zero_weights;
+          E_.overrun_times.insert(E_.overrun_times.end(), T.overrun_times.cbegin(), T.overrun_times.cend());
+          E_.lambda_times.insert(E_.lambda_times.end(), T.lambda_times.cbegin(), T.lambda_times.cend());
+          for (size_t r = 0; r < attempts.size(); ++r) attempts[r] += T.attempts[r];
+        });
+      }
+
+      const sampler_streams streams;
+      unsigned base = 0;                        // augmentation index of outcome[0]
+      std::vector<unsigned char> outcome;       // ordered runs
+      std::vector<float> reject_time;           // ordered runs, relative time of overrun and lambda rejections
+      std::vector<unsigned> index;              // augmentation index of accepted trees
+      std::vector<int> attempts;                // per replicate, see tally()
+
+    private:
+      // distinct elements of outcome per thread, no lock
+      void reject(tally_t& T, unsigned i, augmentation_outcome o, double t)
+      {
+        if (ordered_) {
+          outcome[i - base] = o;
+          reject_time[i - base] = static_cast<float>(t);
+        }
+        ++T.attempts[streams.replicate(i)];
+        switch (o) {
+          case overrun: 
+            ++T.overruns; 
+            T.overrun_times.push_back(t); 
+            break;
+          case lambda: 
+            ++T.lambda; 
+            T.lambda_times.push_back(t); 
+            break;
+          default: 
+            ++T.zero_weights; 
+            break;
+        }
+      }
+
+      const mixture_proposal proposal_;
+      Model* model_;
+      int max_missing_;
+      double max_lambda_;
+      bool compact_;
+      bool replay_;
+      bool ordered_;
+      const deadline_t* deadline_;
+      E_step_t& E_;
+      tbb::combinable<tally_t> tally_;
+      tree_t init_tree_;
+      double age_ = 0.0;
+      std::mutex mutex_;
+      std::atomic<bool> stop_{ false };         // cancelled or N reached
+    };
+
+
+    // normalizes the weights and estimates fhat from the counts in E
+    template <typename REPLICATE>
+    void finish(const std::vector<unsigned>& index, const std::vector<int>& attempts, unsigned replicates, REPLICATE&& replicate, E_step_t& E)
+    {
+      const double max_log_w = normalize_log_weights(E.weights);
+      const double sum_w = std::accumulate(E.weights.cbegin(), E.weights.cend(), 0.0);
+      E.rejected = E.rejected_lambda + E.rejected_overruns + E.rejected_zero_weights;
+      E.fhat = std::log(sum_w / (E.weights.size() + E.rejected)) + max_log_w;
+      E.ess = effective_sample_size(E.weights);
+      std::vector<double> replicate_w(replicates, 0.0);
+      for (size_t j = 0; j < index.size(); ++j) {
+        replicate_w[replicate(index[j])] += E.weights[j];
+      }
+      E.fhat_var = fhat_variance(replicate_w, attempts);
+    }
+
+  }
+
+
+  sampler_t make_sampler_type(const std::string& name)
+  {
+    if (name == "iid") return sampler_t::iid;
+    if (name == "sobol") return sampler_t::sobol;
+    if (name == "antithetic") return sampler_t::antithetic;
+    throw emphasis_error("unknown sampler");
+  }
+
+
+  prune_t make_prune_type(const std::string& name)
+  {
+    if (name == "none") return prune_t::none;
+    if (name == "threshold") return prune_t::threshold;
+    if (name == "resample") return prune_t::resample;
+    throw emphasis_error("unknown prune type");
+  }
+
+
+  void prune(E_step_t& E, const prune_control_t& control)
+  {
+    if ((control.type == prune_t::none) || E.weights.empty()) {
+      E.pruned_ess = E.ess;
+      return;
+    }
+    const double sum_w = std::accumulate(E.weights.cbegin(), E.weights.cend(), 0.0);
+    std::vector<size_t> keep;
+    std::vector<double> w;
+    if (control.type == prune_t::threshold) {
+      for (size_t i = 0; i < E.weights.size(); ++i) {
+        if (E.weights[i] >= control.threshold * sum_w) {
+          keep.push_back(i);
+          w.push_back(E.weights[i]);
+        }
+      }
+    }
+    else {
+      const size_t m = (control.size > 0) ? static_cast<size_t>(control.size) : static_cast<size_t>(std::ceil(E.ess));
+      const uint64_t seed = E.seed ? E.seed : detail::make_random_engine<detail::reng_t>()();
+      const double u = static_cast<double>(detail::stream_seed(seed, detail::prune_stream) >> 11) * (1.0 / 9007199254740992.0);
+      detail::systematic_resample(E.weights, std::max(size_t(1), m), u, keep, w);
+    }
+    double kept = 0.0;
+    for (auto i : keep) kept += E.weights[i];
+    E.discarded_mass = 1.0 - kept / sum_w;
+    E.pruned = static_cast<int>(E.weights.size() - keep.size());
+    if (E.pooled) {
+      // copy the kept trees, the pool keeps the full sample
+      const auto& pool = *E.pooled;
+      if (!pool.replay.empty()) {
+        E.replay = replay_trees(pool.replay.source(), pool.replay.cache());
+        E.replay.reserve(keep.size());
+        for (auto i : keep) E.replay.push_back(pool.replay, i);
+      }
+      else if (!pool.deltas.empty()) {
+        E.deltas = delta_trees(pool.deltas.backbone());
+        E.deltas.reserve(keep.size(), 0);
+        for (auto i : keep) E.deltas.push_back(pool.deltas, i);
+      }
+      else {
+        E.trees.reserve(keep.size());
+        for (auto i : keep) E.trees.push_back(pool.trees[i]);
+      }
+      E.pooled = nullptr;
+    }
+    else {
+      // compact, keep is ascending
+      if (!E.deltas.empty()) {
+        delta_trees deltas(E.deltas.backbone());
+        deltas.reserve(keep.size(), 0);
+        for (auto i : keep) deltas.push_back(E.deltas, i);
+        E.deltas = std::move(deltas);
+      }
+      if (!E.replay.empty()) {
+        replay_trees replay(E.replay.source(), E.replay.cache());
+        replay.reserve(keep.size());
+        for (auto i : keep) replay.push_back(E.replay, i);
+        E.replay = std::move(replay);
+      }
+      if (!E.trees.empty()) {
+        for (size_t j = 0; j < keep.size(); ++j) E.trees[j] = std::move(E.trees[keep[j]]);
+        E.trees.resize(keep.size());
+      }
+    }
+    for (size_t j = 0; j < keep.size(); ++j) {
+      if (!E.logf.empty()) E.logf[j] = E.logf[keep[j]];
+      if (!E.logg.empty()) E.logg[j] = E.logg[keep[j]];
+    }
+    if (!E.logf.empty()) E.logf.resize(keep.size());
+    if (!E.logg.empty()) E.logg.resize(keep.size());
+    E.weights = std::move(w);
+    E.pruned_ess = detail::effective_sample_size(E.weights);
   }
 
 
@@ -46,73 +536,245 @@ namespace emphasis {
                   int soc,
                   int max_missing,
                   double max_lambda,
-                  int num_threads)
+                  int num_threads,
+                  const sampler_control_t& sampler,
+                  bool compact,
+                  const deadline_t* deadline)
   {
     if (!model->is_threadsafe()) num_threads = 1;
     tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
-    std::mutex mutex;
-    std::atomic<bool> stop{ false };    // non-handled exception
-    tree_t init_tree = detail::create_tree(brts, static_cast<double>(soc));
-    std::vector<double> logg_;
-    std::vector<double> logf_;
+    // seeded samples are reproducible: augmentations run in batches and
+    // the sample consists of the first N accepted trees by index. Sobol'
+    // points are balanced over a prefix of the index space, so sobol samples
+    // take the first N accepted trees as well.
+    const bool ordered = (sampler.seed != 0) || (sampler.type == sampler_t::sobol);
     auto E = E_step_t{};
+    detail::augmenter aug(pars, brts, model, soc, max_missing, max_lambda, sampler, compact, ordered, deadline, E);
+    if (sampler.replay) {
+      E.replay.reserve(N);
+    }
+    else if (compact) {
+      E.deltas.reserve(N, 0);
+    }
     auto T0 = std::chrono::high_resolution_clock::now();
-    tbb::parallel_for(tbb::blocked_range<unsigned>(0, maxN), [&](const tbb::blocked_range<unsigned>& r) {
-      for (unsigned i = r.begin(); i < r.end(); ++i) {
-        try {
-          if (!stop) {
-            // reuse tree from pool
-            auto& pool_tree = detail::pooled_tree;
-            emphasis::augment_tree(pars, init_tree, model, max_missing, max_lambda, pool_tree);
-            double log_w = 0.0;
-            double logf = 0.0;
-            double logg = 0.0;
-            {
-              logf = model->loglik(pars, pool_tree);
-              logg = model->sampling_prob(pars, pool_tree);
-              log_w = logf - logg;
-            }
-            if (std::isfinite(log_w) && (0.0 < std::exp(log_w))) {
-              std::lock_guard<std::mutex> _(mutex);
-              if (!stop) {
-                E.trees.emplace_back(pool_tree.cbegin(), pool_tree.cend());
-                E.weights.push_back(log_w);
-                logf_.push_back(logf);
-                logg_.push_back(logg);
-                if (static_cast<int>(E.trees.size()) == N) {
-                  stop = true;
-                }
-              }
-            }
-            else {
-              std::lock_guard<std::mutex> _(mutex);
-              ++E.rejected_zero_weights;
-            }
-          }
-        }
-        catch (const augmentation_overrun&) {
-          std::lock_guard<std::mutex> _(mutex);
-          ++E.rejected_overruns;
-        }
-        catch (const augmentation_lambda&) {
-          std::lock_guard<std::mutex> _(mutex);
-          ++E.rejected_lambda;
-        }
+    unsigned processed = 0;
+    while ((processed < static_cast<unsigned>(maxN)) && !aug.stopped()) {
+      unsigned end = static_cast<unsigned>(maxN);
+      if (ordered) {
+        const size_t missing = static_cast<size_t>(N) - std::min(static_cast<size_t>(N), E.weights.size());
+        if (0 == missing) break;
+        // batch sized by the acceptance rate so far
+        const double rate = processed ? std::max(0.01, static_cast<double>(E.weights.size()) / processed) : 1.0;
+        const double batch = std::max(64.0, std::ceil(missing / rate));
+        end = static_cast<unsigned>(std::min(static_cast<double>(maxN), processed + batch));
       }
-    });
+      aug.run(processed, end, N);
+      processed = end;
+    }
+    auto replicate = [&](unsigned i) { return aug.streams.replicate(i); };
+    if (ordered) {
+      detail::select_first(N, processed, aug.outcome, aug.reject_time, aug.index, aug.attempts, replicate, E);
+    }
+    else {
+      aug.tally();
+    }
     if (static_cast<int>(E.weights.size()) < N) {
-      throw emphasis_error("maxN exceeded");
+      if (!(deadline && deadline->expired())) {
+        throw emphasis_error("maxN exceeded");
+      }
+      E.status = deadline->status();    // partial sample
+    }
+    detail::finish(aug.index, aug.attempts, aug.streams.replicates(), replicate, E);
+    auto T1 = std::chrono::high_resolution_clock::now();
+    E.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+    return E;
+  }
+
+
+  E_shard_t E_shard(unsigned first,
+                    unsigned last,
+                    const param_t& pars,
+                    const brts_t& brts,
+                    Model* model,
+                    int soc,
+                    int max_missing,
+                    double max_lambda,
+                    int num_threads,
+                    const sampler_control_t& sampler,
+                    bool compact,
+                    const deadline_t* deadline)
+  {
+    if (sampler.seed == 0) throw emphasis_error("E_shard requires a sampler seed");
+    if (sampler.replay) throw emphasis_error("E_shard doesn't support seed-replay storage");
+    if (last < first) throw emphasis_error("invalid shard range");
+    if (!model->is_threadsafe()) num_threads = 1;
+    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+    auto T0 = std::chrono::high_resolution_clock::now();
+    E_shard_t S;
+    S.first = first;
+    S.last = last;
+    S.sampler = sampler;
+    detail::augmenter aug(pars, brts, model, soc, max_missing, max_lambda, sampler, compact, true, deadline, S.e);
+    aug.base = first;
+    aug.run(first, last, 0);
+    if (deadline && deadline->expired()) {
+      S.e.status = deadline->status();    // unprocessed augmentations remain pending
+    }
+    detail::sort_by_index(aug.index.size(), aug.index, S.e);
+    // rejection times in index order
+    detail::count_outcomes(last - first, aug.outcome, aug.reject_time, aug.attempts, [&](unsigned i) { return aug.streams.replicate(first + i); }, S.e);
+    S.outcome = std::move(aug.outcome);
+    S.reject_time = std::move(aug.reject_time);
+    S.index = std::move(aug.index);
+    S.e.rejected = S.e.rejected_lambda + S.e.rejected_overruns + S.e.rejected_zero_weights;
+    auto T1 = std::chrono::high_resolution_clock::now();
+    S.e.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+    return S;
+  }
+
+
+  E_step_t merge_shards(std::vector<E_shard_t>& shards, int N)
+  {
+    if (shards.empty()) throw emphasis_error("no shards to merge");
+    std::sort(shards.begin(), shards.end(), [](const E_shard_t& a, const E_shard_t& b) { return a.first < b.first; });
+    const auto& sampler = shards.front().sampler;
+    const bool compact = !shards.front().e.deltas.backbone().empty();
+    unsigned processed = 0;
+    for (const auto& S : shards) {
+      if (S.first != processed) throw emphasis_error("shards don't cover a contiguous range from index 0");
+      const auto& p = S.sampler.proposal;
+      if ((S.sampler.seed != sampler.seed) || (S.sampler.type != sampler.type) || (S.sampler.replicates != sampler.replicates) ||
+          (p.pars != sampler.proposal.pars) || (p.weights != sampler.proposal.weights) || (p.defensive != sampler.proposal.defensive)) {
+        throw emphasis_error("shards from different samplers");
+      }
+      if (compact == S.e.deltas.backbone().empty()) throw emphasis_error("can't merge compact and expanded shards");
+      if ((S.outcome.size() != S.last - S.first) || (S.reject_time.size() != S.outcome.size()) || (S.index.size() != S.e.weights.size())) {
+        throw emphasis_error("malformed shard");
+      }
+      processed = S.last;
+    }
+    const detail::sampler_streams streams(sampler);
+    auto E = E_step_t{};
+    E.seed = streams.seed();
+    if (compact) {
+      E.deltas = delta_trees(shards.front().e.deltas.backbone());
     }
-    const double max_log_w = *std::max_element(E.weights.cbegin(), E.weights.cend());
-    double sum_w = 0.0;
-    for (size_t i = 0; i < E.weights.size(); ++i) {
-      const double w = std::exp(E.weights[i] - max_log_w);
-      sum_w += (E.weights[i] = w);
+    std::vector<unsigned char> outcome;
+    std::vector<float> reject_time;
+    std::vector<unsigned> index;
+    for (auto& S : shards) {
+      outcome.insert(outcome.end(), S.outcome.cbegin(), S.outcome.cend());
+      reject_time.insert(reject_time.end(), S.reject_time.cbegin(), S.reject_time.cend());
+      index.insert(index.end(), S.index.cbegin(), S.index.cend());
+      for (size_t i = 0; i < S.e.deltas.size(); ++i) {
+        E.deltas.push_back(S.e.deltas, i);
+      }
+      std::move(S.e.trees.begin(), S.e.trees.end(), std::back_inserter(E.trees));
+      E.weights.insert(E.weights.end(), S.e.weights.cbegin(), S.e.weights.cend());
+      E.logf.insert(E.logf.end(), S.e.logf.cbegin(), S.e.logf.cend());
+      E.logg.insert(E.logg.end(), S.e.logg.cbegin(), S.e.logg.cend());
+      if ((E.status == run_status_t::completed) && (S.e.status != run_status_t::completed)) {
+        E.status = S.e.status;
+      }
+      E.elapsed += S.e.elapsed;
     }
-    E.rejected = E.rejected_lambda + E.rejected_overruns + E.rejected_zero_weights;
-    E.fhat = std::log(sum_w / (N + E.rejected)) + max_log_w;
+    std::vector<int> attempts(streams.replicates(), 0);
+    auto replicate = [&](unsigned i) { return streams.replicate(i); };
+    detail::select_first((N > 0) ? N : std::numeric_limits<int>::max(), processed, outcome, reject_time, index, attempts, replicate, E);
+    detail::finish(index, attempts, streams.replicates(), replicate, E);
+    return E;
+  }
+
+
+  E_step_t recycle(const param_t& pars,
+                   const tree_pool_t& pool,
+                   Model* model,
+                   int num_threads)
+  {
+    if (!model->is_threadsafe()) num_threads = 1;
+    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+    auto T0 = std::chrono::high_resolution_clock::now();
+    const bool compact = !pool.deltas.empty();
+    const bool replay = !pool.replay.empty();
+    const size_t N = pool.logg.size();
+    auto E = E_step_t{};
+    E.logf.resize(N);
+    E.logg = pool.logg;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, N), [&](const tbb::blocked_range<size_t>& r) {
+      for (size_t i = r.begin(); i < r.end(); ++i) {
+        E.logf[i] = replay ? model->loglik(pars, detail::tree_at(pool.replay, i, detail::pooled_tree))
+                  : compact ? model->loglik(pars, detail::tree_at(pool.deltas, i, detail::pooled_tree))
+                            : model->loglik(pars, pool.trees[i]);
+      }
+    });
+    // keep trees with non-zero weight under pars,
+    // refer to the pool if all of them are kept
+    size_t kept = 0;
+    for (size_t i = 0; i < N; ++i) {
+      if (std::isfinite(E.logf[i] - E.logg[i])) ++kept;
+    }
+    if (kept == N) {
+      E.pooled = &pool;
+    }
+    else if (replay) {
+      E.replay = replay_trees(pool.replay.source(), pool.replay.cache());
+    }
+    else if (compact) {
+      E.deltas = delta_trees(pool.deltas.backbone());
+    }
+    for (size_t i = 0; i < N; ++i) {
+      const double log_w = E.logf[i] - E.logg[i];
+      if (std::isfinite(log_w)) {
+        if (nullptr == E.pooled) {
+          if (replay) {
+            E.replay.push_back(pool.replay, i);
+          }
+          else if (compact) {
+            E.deltas.push_back(pool.deltas, i);
+          }
+          else {
+            E.trees.push_back(pool.trees[i]);
+          }
+        }
+        E.weights.push_back(log_w);
+        E.logf[E.weights.size() - 1] = E.logf[i];
+        E.logg[E.weights.size() - 1] = E.logg[i];
+      }
+      else {
+        ++E.rejected_zero_weights;
+      }
+    }
+    E.logf.resize(E.weights.size());
+    E.logg.resize(E.weights.size());
+    const double max_log_w = detail::normalize_log_weights(E.weights);
+    const double sum_w = std::accumulate(E.weights.cbegin(), E.weights.cend(), 0.0);
+    E.rejected = pool.rejected + E.rejected_zero_weights;
+    E.fhat = std::log(sum_w / (N + pool.rejected)) + max_log_w;
+    E.ess = detail::effective_sample_size(E.weights);
+    E.recycled = true;
     auto T1 = std::chrono::high_resolution_clock::now();
     E.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
     return E;
   }
+
+
+  replay_spec_t replay_spec(const replay_trees& trees)
+  {
+    auto source = dynamic_cast<const detail::augmentation_replay*>(trees.source().get());
+    if (nullptr == source) throw emphasis_error("replay_spec: trees not from E_step");
+    auto spec = source->spec();
+    spec.index.resize(trees.size());
+    for (size_t i = 0; i < trees.size(); ++i) spec.index[i] = trees.stream(i);
+    return spec;
+  }
+
+
+  replay_trees make_replay_trees(const replay_spec_t& spec, Model* model)
+  {
+    auto source = std::make_shared<detail::augmentation_replay>(spec.pars, spec.sampler, spec.backbone, model, spec.max_missing, spec.max_lambda);
+    replay_trees trees(std::move(source), static_cast<size_t>(std::max(0, spec.sampler.replay_cache)));
+    trees.reserve(spec.index.size());
+    for (auto i : spec.index) trees.push_back(i);
+    return trees;
+  }
 }
@@ -10,19 +10,34 @@
 #include "plugin.hpp"
 #include "emphasis.hpp"
 #include "sbplx.hpp"
+#include "mds.hpp"
+#include "delta_tree.hpp"
+#include "weights.hpp"
+#include "model_helpers.hpp"
+#include "qmc.hpp"
 
 
 namespace emphasis {
 
   namespace {
 
+    tree_t thread_local scratch_tree;   // expanded delta tree
+
+    constexpr size_t minibatch_growth = 4;
+    constexpr size_t reduce_grain = 64;   // fixed partition, reproducible sums
+    constexpr size_t point_tile = 16;     // parameter points per tile of batched evaluations
+    constexpr uint64_t minibatch_stream = uint64_t(1) << 42;   // streams of the subsample offsets
+
+
+    template <typename TREES>
     struct nlopt_f_data
     {
       nlopt_f_data(const Model* M, 
-                   const std::vector<tree_t>& Trees, 
+                   const TREES& Trees, 
                    const std::vector<double>& W,
-                   conditional_fun_t* Conditional)
-        : model(M), trees(Trees), w(W), conditional(Conditional)
+                   conditional_fun_t* Conditional,
+                   const deadline_t* Deadline)
+        : model(M), trees(Trees), w(W), conditional(Conditional), deadline(Deadline)
       {
       }
 
@@ -32,20 +47,31 @@ namespace emphasis {
       }
 
       const Model* model;
-      const std::vector<tree_t>& trees;
+      const TREES& trees;
       const std::vector<double>& w;
       conditional_fun_t* conditional;
+      const deadline_t* deadline;
+      sbplx* nlopt = nullptr;
+      const std::vector<size_t>* index = nullptr;     // subsample, w is aligned to index
+
+      size_t size() const { return index ? index->size() : trees.size(); }
+      const tree_t& tree(size_t i) const { return detail::tree_at(trees, index ? (*index)[i] : i, scratch_tree); }
     };
 
 
+    template <typename TREES>
     double objective(unsigned int n, const double* x, double*, void* func_data)
     {
-      auto psd = reinterpret_cast<nlopt_f_data*>(func_data);
+      auto psd = reinterpret_cast<nlopt_f_data<TREES>*>(func_data);
+      if (psd->deadline && psd->deadline->check()) {
+        psd->nlopt->force_stop();
+        return std::numeric_limits<double>::infinity();
+      }
       param_t pars(x, x + n);
-      const double Q = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, psd->trees.size()), 0.0, 
+      const double Q = tbb::parallel_deterministic_reduce(tbb::blocked_range<size_t>(0, psd->size(), reduce_grain), 0.0, 
         [&](const tbb::blocked_range<size_t>& r, double q) -> double {
           for (size_t i = r.begin(); i < r.end(); ++i) {
-            const double loglik = psd->model->loglik(pars, psd->trees[i]);
+            const double loglik = psd->model->loglik(pars, psd->tree(i));
             q += loglik * psd->w[i];
           }
           return q;
@@ -57,10 +83,186 @@ namespace emphasis {
       }
       return -Q * psd->conditional->operator()(pars);
     }
+
+
+    // weighted logliks at all points in one parallel pass.
+    // Tiles of reduce_grain trees x point_tile points, each tree is
+    // fetched (expanded) once per tile.
+    template <typename TREES>
+    std::vector<double> weighted_loglik(const std::vector<param_t>& pars, const nlopt_f_data<TREES>& sd)
+    {
+      const size_t m = pars.size();
+      const size_t tree_tiles = (sd.size() + reduce_grain - 1) / reduce_grain;
+      const size_t point_tiles = (m + point_tile - 1) / point_tile;
+      return tbb::parallel_deterministic_reduce(tbb::blocked_range<size_t>(0, tree_tiles * point_tiles, 1), std::vector<double>(m, 0.0),
+        [&](const tbb::blocked_range<size_t>& r, std::vector<double> q) -> std::vector<double> {
+          for (size_t k = r.begin(); k < r.end(); ++k) {
+            const size_t i0 = (k % tree_tiles) * reduce_grain;
+            const size_t i1 = std::min(sd.size(), i0 + reduce_grain);
+            const size_t j0 = (k / tree_tiles) * point_tile;
+            const size_t j1 = std::min(m, j0 + point_tile);
+            for (size_t i = i0; i < i1; ++i) {
+              const tree_t& tree = sd.tree(i);
+              for (size_t j = j0; j < j1; ++j) {
+                q[j] += sd.model->loglik(pars[j], tree) * sd.w[i];
+              }
+            }
+          }
+          return q;
+        },
+        [](std::vector<double> a, const std::vector<double>& b) -> std::vector<double> {
+          for (size_t j = 0; j < a.size(); ++j) a[j] += b[j];
+          return a;
+        }
+      );
+    }
+
+
+    // objective at m points
+    template <typename TREES>
+    void batch_objective(size_t m, const double* x, double* f, size_t n, const nlopt_f_data<TREES>& sd)
+    {
+      std::vector<param_t> pars(m);
+      for (size_t j = 0; j < m; ++j) {
+        pars[j].assign(x + j * n, x + (j + 1) * n);
+      }
+      const auto Q = weighted_loglik(pars, sd);
+      for (size_t j = 0; j < m; ++j) {
+        f[j] = (nullptr == sd.conditional) ? -Q[j] : -Q[j] * sd.conditional->operator()(pars[j]);
+      }
+    }
+
+
+    // optimizes from M.estimates, initial_step relative to |x|, 0: optimizer default
+    template <typename TREES>
+    void optimize(nlopt_f_data<TREES>& sd,
+                  M_step_t& M,
+                  const param_t& lower,
+                  const param_t& upper,
+                  double xtol_rel,
+                  m_optimizer_t optimizer,
+                  const deadline_t* deadline,
+                  double initial_step = 0.0)
+    {
+      if (optimizer == m_optimizer_t::mds) {
+        const size_t n = M.estimates.size();
+        mds opt(n);
+        opt.set_xtol_rel(xtol_rel);
+        if (initial_step > 0.0) opt.set_initial_step(initial_step);
+        if (!lower.empty()) opt.set_lower_bounds(lower);
+        if (!upper.empty()) opt.set_upper_bounds(upper);
+        opt.set_min_objective([&](size_t m, const double* x, double* f) { batch_objective(m, x, f, n, sd); });
+        if (deadline) opt.set_stop([deadline]() { return deadline->check(); });
+        M.minf = opt.optimize(M.estimates);
+        M.opt = static_cast<int>(opt.result());
+      }
+      else {
+        sbplx nlopt(M.estimates.size());
+        nlopt.set_xtol_rel(xtol_rel);
+        if (!lower.empty()) nlopt.set_lower_bounds(lower);
+        if (!upper.empty()) nlopt.set_upper_bounds(upper);
+        if (initial_step > 0.0) {
+          param_t dx(M.estimates.size());
+          std::transform(M.estimates.cbegin(), M.estimates.cend(), dx.begin(), [=](double x) {
+            return (x != 0.0) ? initial_step * std::abs(x) : initial_step;
+          });
+          nlopt.set_initial_step(dx);
+        }
+        sd.nlopt = &nlopt;
+        nlopt.set_min_objective(objective<TREES>, &sd);
+        M.minf = nlopt.optimize(M.estimates);
+        M.opt = static_cast<int>(nlopt.result());
+      }
+    }
+
+
+    template <typename TREES>
+    M_step_t do_M_step(const param_t& pars,
+                       const TREES& trees,
+                       const std::vector<double>& weights,
+                       class Model* model,
+                       const param_t& lower_bound,
+                       const param_t& upper_bound,
+                       double xtol_rel,
+                       int num_threads,
+                       conditional_fun_t* conditional,
+                       m_optimizer_t optimizer,
+                       const deadline_t* deadline,
+                       int minibatch,
+                       uint64_t seed)
+    {
+      if (!model->is_threadsafe()) num_threads = 1;
+      tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+      auto T0 = std::chrono::high_resolution_clock::now();
+      nlopt_f_data<TREES> sd{ model, trees, weights, conditional, deadline };
+      auto M = M_step_t{};
+      M.estimates = pars;
+      auto lower = lower_bound.empty() ? model->lower_bound() : lower_bound;
+      auto upper = upper_bound.empty() ? model->upper_bound() : upper_bound;
+      double initial_step = 0.0;      // optimizer default
+      if (minibatch > 0) {
+        // growing subsamples, tolerance tracks the subsample error,
+        // each stage starts in the neighbourhood of the previous one
+        const size_t T = trees.size();
+        std::vector<size_t> index;
+        std::vector<double> sw;
+        if (seed == 0) seed = detail::make_random_engine<detail::reng_t>()();
+        uint64_t stage = 0;
+        for (size_t m = minibatch; 2 * m < T; m *= minibatch_growth, ++stage) {
+          const double u = static_cast<double>(detail::stream_seed(seed, minibatch_stream + stage) >> 11) * (1.0 / 9007199254740992.0);
+          detail::systematic_resample(weights, m, u, index, sw);
+          nlopt_f_data<TREES> sub{ model, trees, sw, conditional, deadline };
+          sub.index = &index;
+          const double xtol = std::max(xtol_rel, std::min(0.1, xtol_rel * std::sqrt(static_cast<double>(T) / static_cast<double>(m))));
+          optimize(sub, M, lower, upper, xtol, optimizer, deadline, initial_step);
+          if (M.opt == NLOPT_FORCED_STOP) break;
+          initial_step = std::min(0.1, 10.0 * xtol);
+        }
+      }
+      if (M.opt != NLOPT_FORCED_STOP) {
+        optimize(sd, M, lower, upper, xtol_rel, optimizer, deadline, initial_step);     // full sample
+      }
+      if (M.opt == NLOPT_FORCED_STOP) {
+        M.status = deadline->status();
+      }
+      auto T1 = std::chrono::high_resolution_clock::now();
+      M.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+      return M;
+    }
+
+
+    template <typename TREES>
+    std::vector<double> do_Q_surface(const std::vector<param_t>& pars,
+                                     const TREES& trees,
+                                     const std::vector<double>& weights,
+                                     class Model* model,
+                                     conditional_fun_t* conditional,
+                                     int num_threads)
+    {
+      if (trees.size() != weights.size()) throw emphasis_error("Q_surface: size of weights doesn't match trees");
+      if (!model->is_threadsafe()) num_threads = 1;
+      tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+      nlopt_f_data<TREES> sd{ model, trees, weights, conditional, nullptr };
+      auto Q = weighted_loglik(pars, sd);
+      if (conditional) {
+        for (size_t j = 0; j < Q.size(); ++j) {
+          Q[j] *= conditional->operator()(pars[j]);
+        }
+      }
+      return Q;
+    }
     
   }
 
 
+  m_optimizer_t make_m_optimizer(const std::string& name)
+  {
+    if (name == "sbplx") return m_optimizer_t::sbplx;
+    if (name == "mds") return m_optimizer_t::mds;
+    throw emphasis_error("unknown optimizer");
+  }
+
+
   M_step_t M_step(const param_t& pars,
                   const std::vector<tree_t>& trees,          // augmented trees
                   const std::vector<double>& weights,
@@ -69,26 +271,82 @@ namespace emphasis {
                   const param_t& upper_bound, // overrides model.upper.bound
                   double xtol_rel,
                   int num_threads,
-                  conditional_fun_t* conditional)
+                  conditional_fun_t* conditional,
+                  m_optimizer_t optimizer,
+                  const deadline_t* deadline,
+                  int minibatch,
+                  uint64_t seed)
+  {
+    return do_M_step(pars, trees, weights, model, lower_bound, upper_bound, xtol_rel, num_threads, conditional, optimizer, deadline, minibatch, seed);
+  }
+
+
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const std::vector<tree_t>& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional,
+                                int num_threads)
+  {
+    return do_Q_surface(pars, trees, weights, model, conditional, num_threads);
+  }
+
+
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const delta_trees& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional,
+                                int num_threads)
+  {
+    return do_Q_surface(pars, trees, weights, model, conditional, num_threads);
+  }
+
+
+  std::vector<double> Q_surface(const std::vector<param_t>& pars,
+                                const replay_trees& trees,
+                                const std::vector<double>& weights,
+                                class Model* model,
+                                conditional_fun_t* conditional,
+                                int num_threads)
+  {
+    return do_Q_surface(pars, trees, weights, model, conditional, num_threads);
+  }
+
+
+  M_step_t M_step(const param_t& pars,
+                  const delta_trees& trees,
+                  const std::vector<double>& weights,
+                  class Model* model,
+                  const param_t& lower_bound,
+                  const param_t& upper_bound,
+                  double xtol_rel,
+                  int num_threads,
+                  conditional_fun_t* conditional,
+                  m_optimizer_t optimizer,
+                  const deadline_t* deadline,
+                  int minibatch,
+                  uint64_t seed)
+  {
+    return do_M_step(pars, trees, weights, model, lower_bound, upper_bound, xtol_rel, num_threads, conditional, optimizer, deadline, minibatch, seed);
+  }
+
+
+  M_step_t M_step(const param_t& pars,
+                  const replay_trees& trees,
+                  const std::vector<double>& weights,
+                  class Model* model,
+                  const param_t& lower_bound,
+                  const param_t& upper_bound,
+                  double xtol_rel,
+                  int num_threads,
+                  conditional_fun_t* conditional,
+                  m_optimizer_t optimizer,
+                  const deadline_t* deadline,
+                  int minibatch,
+                  uint64_t seed)
   {
-    if (!model->is_threadsafe()) num_threads = 1;
-    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
-    auto T0 = std::chrono::high_resolution_clock::now();
-    nlopt_f_data sd{ model, trees, weights, conditional };
-    auto M = M_step_t{};
-    sbplx nlopt(pars.size());
-    M.estimates = pars;
-    nlopt.set_xtol_rel(xtol_rel);
-    auto lower = lower_bound.empty() ? model->lower_bound() : lower_bound;
-    if (!lower.empty()) nlopt.set_lower_bounds(lower);
-    auto upper = upper_bound.empty() ? model->upper_bound() : upper_bound;
-    if (!upper.empty()) nlopt.set_upper_bounds(upper);
-    nlopt.set_min_objective(objective, &sd);
-    M.minf = nlopt.optimize(M.estimates);
-    M.opt = static_cast<int>(nlopt.result());
-    auto T1 = std::chrono::high_resolution_clock::now();
-    M.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
-    return M;
+    return do_M_step(pars, trees, weights, model, lower_bound, upper_bound, xtol_rel, num_threads, conditional, optimizer, deadline, minibatch, seed);
   }
 
 }
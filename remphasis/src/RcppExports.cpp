@@ -5,9 +5,361 @@
 
 using namespace Rcpp;
 
+// rcpp_async_progress
+List rcpp_async_progress(SEXP handle);
+RcppExport SEXP _remphasis_rcpp_async_progress(SEXP handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type handle(handleSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_async_progress(handle));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_async_wait
+bool rcpp_async_wait(SEXP handle, double timeout);
+RcppExport SEXP _remphasis_rcpp_async_wait(SEXP handleSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type handle(handleSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_async_wait(handle, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_async_cancel
+void rcpp_async_cancel(SEXP handle);
+RcppExport SEXP _remphasis_rcpp_async_cancel(SEXP handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type handle(handleSEXP);
+    rcpp_async_cancel(handle);
+    return R_NilValue;
+END_RCPP
+}
+// rcpp_async_result
+List rcpp_async_result(SEXP handle);
+RcppExport SEXP _remphasis_rcpp_async_result(SEXP handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type handle(handleSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_async_result(handle));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_mcem_chains
+List rcpp_mcem_chains(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, int chains, double dispersion, int burnin, int check_interval, int max_iterations, double max_rhat, SEXP rconditional, const std::string& sampler, int replicates, const std::string& optimizer, bool compact, double max_time, double seed);
+RcppExport SEXP _remphasis_rcpp_mcem_chains(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP chainsSEXP, SEXP dispersionSEXP, SEXP burninSEXP, SEXP check_intervalSEXP, SEXP max_iterationsSEXP, SEXP max_rhatSEXP, SEXP rconditionalSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP optimizerSEXP, SEXP compactSEXP, SEXP max_timeSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type chains(chainsSEXP);
+    Rcpp::traits::input_parameter< double >::type dispersion(dispersionSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin(burninSEXP);
+    Rcpp::traits::input_parameter< int >::type check_interval(check_intervalSEXP);
+    Rcpp::traits::input_parameter< int >::type max_iterations(max_iterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type max_rhat(max_rhatSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mcem_chains(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, chains, dispersion, burnin, check_interval, max_iterations, max_rhat, rconditional, sampler, replicates, optimizer, compact, max_time, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_fit
+List rcpp_fit(const std::vector<double>& brts, const std::vector<double>& init_pars, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, int burnin_sample_size, const std::vector<int>& pilot_sample_size, int burnin_iterations, double em_tol, double sample_size_tol, double recycle_ess, int max_iterations, SEXP rconditional, Nullable<Function> rprogress, const std::string& sampler, int replicates, const std::string& optimizer, bool compact, double max_time, int minibatch, const std::string& prune, double prune_threshold, const std::string& checkpoint, int checkpoint_interval, bool resume, bool adapt_proposal, double defensive, bool replay, int replay_cache, double seed);
+RcppExport SEXP _remphasis_rcpp_fit(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP burnin_sample_sizeSEXP, SEXP pilot_sample_sizeSEXP, SEXP burnin_iterationsSEXP, SEXP em_tolSEXP, SEXP sample_size_tolSEXP, SEXP recycle_essSEXP, SEXP max_iterationsSEXP, SEXP rconditionalSEXP, SEXP rprogressSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP optimizerSEXP, SEXP compactSEXP, SEXP max_timeSEXP, SEXP minibatchSEXP, SEXP pruneSEXP, SEXP prune_thresholdSEXP, SEXP checkpointSEXP, SEXP checkpoint_intervalSEXP, SEXP resumeSEXP, SEXP adapt_proposalSEXP, SEXP defensiveSEXP, SEXP replaySEXP, SEXP replay_cacheSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin_sample_size(burnin_sample_sizeSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type pilot_sample_size(pilot_sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin_iterations(burnin_iterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type em_tol(em_tolSEXP);
+    Rcpp::traits::input_parameter< double >::type sample_size_tol(sample_size_tolSEXP);
+    Rcpp::traits::input_parameter< double >::type recycle_ess(recycle_essSEXP);
+    Rcpp::traits::input_parameter< int >::type max_iterations(max_iterationsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< Nullable<Function> >::type rprogress(rprogressSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type minibatch(minibatchSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type prune(pruneSEXP);
+    Rcpp::traits::input_parameter< double >::type prune_threshold(prune_thresholdSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< int >::type checkpoint_interval(checkpoint_intervalSEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    Rcpp::traits::input_parameter< bool >::type adapt_proposal(adapt_proposalSEXP);
+    Rcpp::traits::input_parameter< double >::type defensive(defensiveSEXP);
+    Rcpp::traits::input_parameter< bool >::type replay(replaySEXP);
+    Rcpp::traits::input_parameter< int >::type replay_cache(replay_cacheSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_fit(brts, init_pars, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, burnin_sample_size, pilot_sample_size, burnin_iterations, em_tol, sample_size_tol, recycle_ess, max_iterations, rconditional, rprogress, sampler, replicates, optimizer, compact, max_time, minibatch, prune, prune_threshold, checkpoint, checkpoint_interval, resume, adapt_proposal, defensive, replay, replay_cache, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_fit_async
+SEXP rcpp_fit_async(const std::vector<double>& brts, const std::vector<double>& init_pars, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, int burnin_sample_size, const std::vector<int>& pilot_sample_size, int burnin_iterations, double em_tol, double sample_size_tol, double recycle_ess, int max_iterations, SEXP rconditional, const std::string& sampler, int replicates, const std::string& optimizer, bool compact, double max_time, int minibatch, const std::string& prune, double prune_threshold, const std::string& checkpoint, int checkpoint_interval, bool resume, bool adapt_proposal, double defensive, bool replay, int replay_cache, double seed);
+RcppExport SEXP _remphasis_rcpp_fit_async(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP burnin_sample_sizeSEXP, SEXP pilot_sample_sizeSEXP, SEXP burnin_iterationsSEXP, SEXP em_tolSEXP, SEXP sample_size_tolSEXP, SEXP recycle_essSEXP, SEXP max_iterationsSEXP, SEXP rconditionalSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP optimizerSEXP, SEXP compactSEXP, SEXP max_timeSEXP, SEXP minibatchSEXP, SEXP pruneSEXP, SEXP prune_thresholdSEXP, SEXP checkpointSEXP, SEXP checkpoint_intervalSEXP, SEXP resumeSEXP, SEXP adapt_proposalSEXP, SEXP defensiveSEXP, SEXP replaySEXP, SEXP replay_cacheSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin_sample_size(burnin_sample_sizeSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type pilot_sample_size(pilot_sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin_iterations(burnin_iterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type em_tol(em_tolSEXP);
+    Rcpp::traits::input_parameter< double >::type sample_size_tol(sample_size_tolSEXP);
+    Rcpp::traits::input_parameter< double >::type recycle_ess(recycle_essSEXP);
+    Rcpp::traits::input_parameter< int >::type max_iterations(max_iterationsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type minibatch(minibatchSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type prune(pruneSEXP);
+    Rcpp::traits::input_parameter< double >::type prune_threshold(prune_thresholdSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< int >::type checkpoint_interval(checkpoint_intervalSEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    Rcpp::traits::input_parameter< bool >::type adapt_proposal(adapt_proposalSEXP);
+    Rcpp::traits::input_parameter< double >::type defensive(defensiveSEXP);
+    Rcpp::traits::input_parameter< bool >::type replay(replaySEXP);
+    Rcpp::traits::input_parameter< int >::type replay_cache(replay_cacheSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_fit_async(brts, init_pars, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, burnin_sample_size, pilot_sample_size, burnin_iterations, em_tol, sample_size_tol, recycle_ess, max_iterations, rconditional, sampler, replicates, optimizer, compact, max_time, minibatch, prune, prune_threshold, checkpoint, checkpoint_interval, resume, adapt_proposal, defensive, replay, replay_cache, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_trunc_exp
+NumericVector rcpp_trunc_exp(int n, double upper, double rate, double seed);
+RcppExport SEXP _remphasis_rcpp_trunc_exp(SEXP nSEXP, SEXP upperSEXP, SEXP rateSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< double >::type rate(rateSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_trunc_exp(n, upper, rate, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_nh_rate
+List rcpp_nh_rate(const std::string& plugin, const std::vector<double>& pars, DataFrame tree, const std::vector<double>& t);
+RcppExport SEXP _remphasis_rcpp_nh_rate(SEXP pluginSEXP, SEXP parsSEXP, SEXP treeSEXP, SEXP tSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type pars(parsSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type tree(treeSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type t(tSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_nh_rate(plugin, pars, tree, t));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_delta_expand
+List rcpp_delta_expand(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed);
+RcppExport SEXP _remphasis_rcpp_delta_expand(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_delta_expand(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_replay_expand
+List rcpp_replay_expand(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed, int replay_cache);
+RcppExport SEXP _remphasis_rcpp_replay_expand(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP, SEXP replay_cacheSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type replay_cache(replay_cacheSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_replay_expand(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, seed, replay_cache));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_isolated_e
+List rcpp_isolated_e(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed);
+RcppExport SEXP _remphasis_rcpp_isolated_e(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_isolated_e(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_fused_weights
+List rcpp_fused_weights(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed);
+RcppExport SEXP _remphasis_rcpp_fused_weights(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_fused_weights(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_mixture_weights
+List rcpp_mixture_weights(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed, SEXP proposal);
+RcppExport SEXP _remphasis_rcpp_mixture_weights(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP, SEXP proposalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposal(proposalSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mixture_weights(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, seed, proposal));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_envelope_thinning
+List rcpp_envelope_thinning(double rate0, double decay, double age, int runs, double seed);
+RcppExport SEXP _remphasis_rcpp_envelope_thinning(SEXP rate0SEXP, SEXP decaySEXP, SEXP ageSEXP, SEXP runsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type rate0(rate0SEXP);
+    Rcpp::traits::input_parameter< double >::type decay(decaySEXP);
+    Rcpp::traits::input_parameter< double >::type age(ageSEXP);
+    Rcpp::traits::input_parameter< int >::type runs(runsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_envelope_thinning(rate0, decay, age, runs, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_maximize_1d
+double rcpp_maximize_1d(Function f, double a, double b, int max_evals, double xtol_rel);
+RcppExport SEXP _remphasis_rcpp_maximize_1d(SEXP fSEXP, SEXP aSEXP, SEXP bSEXP, SEXP max_evalsSEXP, SEXP xtol_relSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Function >::type f(fSEXP);
+    Rcpp::traits::input_parameter< double >::type a(aSEXP);
+    Rcpp::traits::input_parameter< double >::type b(bSEXP);
+    Rcpp::traits::input_parameter< int >::type max_evals(max_evalsSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_maximize_1d(f, a, b, max_evals, xtol_rel));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_minimize
+List rcpp_minimize(Function f, const std::vector<double>& x0, double xtol_rel);
+RcppExport SEXP _remphasis_rcpp_minimize(SEXP fSEXP, SEXP x0SEXP, SEXP xtol_relSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Function >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type x0(x0SEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_minimize(f, x0, xtol_rel));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_gelman_rubin
+List rcpp_gelman_rubin(List chains);
+RcppExport SEXP _remphasis_rcpp_gelman_rubin(SEXP chainsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type chains(chainsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_gelman_rubin(chains));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rcpp_mce
-List rcpp_mce(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads);
-RcppExport SEXP _remphasis_rcpp_mce(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP) {
+List rcpp_mce(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, const std::string& sampler, int replicates, double max_time, SEXP proposal, double seed);
+RcppExport SEXP _remphasis_rcpp_mce(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP max_timeSEXP, SEXP proposalSEXP, SEXP seedSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -23,13 +375,78 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
     Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
     Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_mce(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads));
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposal(proposalSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mce(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, sampler, replicates, max_time, proposal, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_mce_async
+SEXP rcpp_mce_async(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, const std::string& sampler, int replicates, double max_time, SEXP proposal);
+RcppExport SEXP _remphasis_rcpp_mce_async(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP max_timeSEXP, SEXP proposalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposal(proposalSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mce_async(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, num_threads, sampler, replicates, max_time, proposal));
     return rcpp_result_gen;
 END_RCPP
 }
 // rcpp_mcem
-List rcpp_mcem(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, bool copy_trees, Nullable<Function> rconditional);
-RcppExport SEXP _remphasis_rcpp_mcem(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP copy_treesSEXP, SEXP rconditionalSEXP) {
+List rcpp_mcem(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, bool copy_trees, SEXP rconditional, SEXP pool, double min_ess, const std::string& sampler, int replicates, const std::string& optimizer, bool compact, double max_time, int minibatch, const std::string& prune, double prune_threshold, SEXP proposal, bool replay, int replay_cache);
+RcppExport SEXP _remphasis_rcpp_mcem(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP copy_treesSEXP, SEXP rconditionalSEXP, SEXP poolSEXP, SEXP min_essSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP optimizerSEXP, SEXP compactSEXP, SEXP max_timeSEXP, SEXP minibatchSEXP, SEXP pruneSEXP, SEXP prune_thresholdSEXP, SEXP proposalSEXP, SEXP replaySEXP, SEXP replay_cacheSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type copy_trees(copy_treesSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pool(poolSEXP);
+    Rcpp::traits::input_parameter< double >::type min_ess(min_essSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type minibatch(minibatchSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type prune(pruneSEXP);
+    Rcpp::traits::input_parameter< double >::type prune_threshold(prune_thresholdSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposal(proposalSEXP);
+    Rcpp::traits::input_parameter< bool >::type replay(replaySEXP);
+    Rcpp::traits::input_parameter< int >::type replay_cache(replay_cacheSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mcem(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, copy_trees, rconditional, pool, min_ess, sampler, replicates, optimizer, compact, max_time, minibatch, prune, prune_threshold, proposal, replay, replay_cache));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_mcem_async
+SEXP rcpp_mcem_async(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, bool copy_trees, SEXP rconditional, SEXP pool, double min_ess, const std::string& sampler, int replicates, const std::string& optimizer, bool compact, double max_time, int minibatch, const std::string& prune, double prune_threshold, SEXP proposal, bool replay, int replay_cache);
+RcppExport SEXP _remphasis_rcpp_mcem_async(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP copy_treesSEXP, SEXP rconditionalSEXP, SEXP poolSEXP, SEXP min_essSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP optimizerSEXP, SEXP compactSEXP, SEXP max_timeSEXP, SEXP minibatchSEXP, SEXP pruneSEXP, SEXP prune_thresholdSEXP, SEXP proposalSEXP, SEXP replaySEXP, SEXP replay_cacheSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -46,14 +463,37 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
     Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
     Rcpp::traits::input_parameter< bool >::type copy_trees(copy_treesSEXP);
-    Rcpp::traits::input_parameter< Nullable<Function> >::type rconditional(rconditionalSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_mcem(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, copy_trees, rconditional));
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pool(poolSEXP);
+    Rcpp::traits::input_parameter< double >::type min_ess(min_essSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type minibatch(minibatchSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type prune(pruneSEXP);
+    Rcpp::traits::input_parameter< double >::type prune_threshold(prune_thresholdSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposal(proposalSEXP);
+    Rcpp::traits::input_parameter< bool >::type replay(replaySEXP);
+    Rcpp::traits::input_parameter< int >::type replay_cache(replay_cacheSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mcem_async(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, copy_trees, rconditional, pool, min_ess, sampler, replicates, optimizer, compact, max_time, minibatch, prune, prune_threshold, proposal, replay, replay_cache));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_tree_pool
+SEXP rcpp_tree_pool();
+RcppExport SEXP _remphasis_rcpp_tree_pool() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(rcpp_tree_pool());
     return rcpp_result_gen;
 END_RCPP
 }
 // rcpp_mcm
-List rcpp_mcm(List e_step, const std::vector<double>& init_pars, const std::string& plugin, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, Nullable<Function> rconditional);
-RcppExport SEXP _remphasis_rcpp_mcm(SEXP e_stepSEXP, SEXP init_parsSEXP, SEXP pluginSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP rconditionalSEXP) {
+List rcpp_mcm(List e_step, const std::vector<double>& init_pars, const std::string& plugin, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, SEXP rconditional, const std::string& optimizer, double max_time, int minibatch);
+RcppExport SEXP _remphasis_rcpp_mcm(SEXP e_stepSEXP, SEXP init_parsSEXP, SEXP pluginSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP rconditionalSEXP, SEXP optimizerSEXP, SEXP max_timeSEXP, SEXP minibatchSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -64,16 +504,165 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
     Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
     Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
-    Rcpp::traits::input_parameter< Nullable<Function> >::type rconditional(rconditionalSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_mcm(e_step, init_pars, plugin, lower_bound, upper_bound, xtol_rel, num_threads, rconditional));
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type optimizer(optimizerSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type minibatch(minibatchSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_mcm(e_step, init_pars, plugin, lower_bound, upper_bound, xtol_rel, num_threads, rconditional, optimizer, max_time, minibatch));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_q
+NumericVector rcpp_q(List e_step, NumericMatrix pars, const std::string& plugin, SEXP rconditional, int num_threads);
+RcppExport SEXP _remphasis_rcpp_q(SEXP e_stepSEXP, SEXP parsSEXP, SEXP pluginSEXP, SEXP rconditionalSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type e_step(e_stepSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type pars(parsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_q(e_step, pars, plugin, rconditional, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_adapt_proposal
+List rcpp_adapt_proposal(List e_step, const std::vector<double>& pars, const std::string& plugin, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double defensive, int num_threads);
+RcppExport SEXP _remphasis_rcpp_adapt_proposal(SEXP e_stepSEXP, SEXP parsSEXP, SEXP pluginSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP defensiveSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type e_step(e_stepSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type pars(parsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type defensive(defensiveSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_adapt_proposal(e_step, pars, plugin, lower_bound, upper_bound, defensive, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_saem
+List rcpp_saem(const std::vector<double>& brts, const std::vector<double>& init_pars, int sample_size, int maxN, const std::string& plugin, int soc, int max_missing, double max_lambda, const std::vector<double>& lower_bound, const std::vector<double>& upper_bound, double xtol_rel, int num_threads, int burnin, int max_iterations, double alpha, double tol, int patience, int max_pool, SEXP rconditional, const std::string& sampler, int replicates, bool compact, double seed, double max_time);
+RcppExport SEXP _remphasis_rcpp_saem(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP sample_sizeSEXP, SEXP maxNSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP lower_boundSEXP, SEXP upper_boundSEXP, SEXP xtol_relSEXP, SEXP num_threadsSEXP, SEXP burninSEXP, SEXP max_iterationsSEXP, SEXP alphaSEXP, SEXP tolSEXP, SEXP patienceSEXP, SEXP max_poolSEXP, SEXP rconditionalSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP compactSEXP, SEXP seedSEXP, SEXP max_timeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxN(maxNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type lower_bound(lower_boundSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type upper_bound(upper_boundSEXP);
+    Rcpp::traits::input_parameter< double >::type xtol_rel(xtol_relSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type burnin(burninSEXP);
+    Rcpp::traits::input_parameter< int >::type max_iterations(max_iterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type alpha(alphaSEXP);
+    Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< int >::type patience(patienceSEXP);
+    Rcpp::traits::input_parameter< int >::type max_pool(max_poolSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rconditional(rconditionalSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_saem(brts, init_pars, sample_size, maxN, plugin, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, burnin, max_iterations, alpha, tol, patience, max_pool, rconditional, sampler, replicates, compact, seed, max_time));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_e_shard
+List rcpp_e_shard(const std::vector<double>& brts, const std::vector<double>& init_pars, int first, int last, const std::string& plugin, int soc, int max_missing, double max_lambda, int num_threads, double seed, const std::string& sampler, int replicates, double max_time);
+RcppExport SEXP _remphasis_rcpp_e_shard(SEXP brtsSEXP, SEXP init_parsSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP max_missingSEXP, SEXP max_lambdaSEXP, SEXP num_threadsSEXP, SEXP seedSEXP, SEXP samplerSEXP, SEXP replicatesSEXP, SEXP max_timeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type brts(brtsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type init_pars(init_parsSEXP);
+    Rcpp::traits::input_parameter< int >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< int >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type max_missing(max_missingSEXP);
+    Rcpp::traits::input_parameter< double >::type max_lambda(max_lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< int >::type replicates(replicatesSEXP);
+    Rcpp::traits::input_parameter< double >::type max_time(max_timeSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_e_shard(brts, init_pars, first, last, plugin, soc, max_missing, max_lambda, num_threads, seed, sampler, replicates, max_time));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_e_merge
+List rcpp_e_merge(List shards, int sample_size);
+RcppExport SEXP _remphasis_rcpp_e_merge(SEXP shardsSEXP, SEXP sample_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type shards(shardsSEXP);
+    Rcpp::traits::input_parameter< int >::type sample_size(sample_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_e_merge(shards, sample_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_survival
+NumericVector rcpp_survival(NumericMatrix pars, double age, const std::string& plugin, int soc, int simulations, int max_lineages, double seed, int num_threads);
+RcppExport SEXP _remphasis_rcpp_survival(SEXP parsSEXP, SEXP ageSEXP, SEXP pluginSEXP, SEXP socSEXP, SEXP simulationsSEXP, SEXP max_lineagesSEXP, SEXP seedSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type pars(parsSEXP);
+    Rcpp::traits::input_parameter< double >::type age(ageSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type plugin(pluginSEXP);
+    Rcpp::traits::input_parameter< int >::type soc(socSEXP);
+    Rcpp::traits::input_parameter< int >::type simulations(simulationsSEXP);
+    Rcpp::traits::input_parameter< int >::type max_lineages(max_lineagesSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_survival(pars, age, plugin, soc, simulations, max_lineages, seed, num_threads));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_remphasis_rcpp_mce", (DL_FUNC) &_remphasis_rcpp_mce, 12},
-    {"_remphasis_rcpp_mcem", (DL_FUNC) &_remphasis_rcpp_mcem, 14},
-    {"_remphasis_rcpp_mcm", (DL_FUNC) &_remphasis_rcpp_mcm, 8},
+    {"_remphasis_rcpp_async_progress", (DL_FUNC) &_remphasis_rcpp_async_progress, 1},
+    {"_remphasis_rcpp_async_wait", (DL_FUNC) &_remphasis_rcpp_async_wait, 2},
+    {"_remphasis_rcpp_async_cancel", (DL_FUNC) &_remphasis_rcpp_async_cancel, 1},
+    {"_remphasis_rcpp_async_result", (DL_FUNC) &_remphasis_rcpp_async_result, 1},
+    {"_remphasis_rcpp_mcem_chains", (DL_FUNC) &_remphasis_rcpp_mcem_chains, 25},
+    {"_remphasis_rcpp_fit", (DL_FUNC) &_remphasis_rcpp_fit, 35},
+    {"_remphasis_rcpp_fit_async", (DL_FUNC) &_remphasis_rcpp_fit_async, 34},
+    {"_remphasis_rcpp_trunc_exp", (DL_FUNC) &_remphasis_rcpp_trunc_exp, 4},
+    {"_remphasis_rcpp_nh_rate", (DL_FUNC) &_remphasis_rcpp_nh_rate, 4},
+    {"_remphasis_rcpp_delta_expand", (DL_FUNC) &_remphasis_rcpp_delta_expand, 10},
+    {"_remphasis_rcpp_replay_expand", (DL_FUNC) &_remphasis_rcpp_replay_expand, 11},
+    {"_remphasis_rcpp_isolated_e", (DL_FUNC) &_remphasis_rcpp_isolated_e, 10},
+    {"_remphasis_rcpp_fused_weights", (DL_FUNC) &_remphasis_rcpp_fused_weights, 10},
+    {"_remphasis_rcpp_mixture_weights", (DL_FUNC) &_remphasis_rcpp_mixture_weights, 11},
+    {"_remphasis_rcpp_envelope_thinning", (DL_FUNC) &_remphasis_rcpp_envelope_thinning, 5},
+    {"_remphasis_rcpp_maximize_1d", (DL_FUNC) &_remphasis_rcpp_maximize_1d, 5},
+    {"_remphasis_rcpp_minimize", (DL_FUNC) &_remphasis_rcpp_minimize, 3},
+    {"_remphasis_rcpp_gelman_rubin", (DL_FUNC) &_remphasis_rcpp_gelman_rubin, 1},
+    {"_remphasis_rcpp_mce", (DL_FUNC) &_remphasis_rcpp_mce, 17},
+    {"_remphasis_rcpp_mce_async", (DL_FUNC) &_remphasis_rcpp_mce_async, 13},
+    {"_remphasis_rcpp_mcem", (DL_FUNC) &_remphasis_rcpp_mcem, 27},
+    {"_remphasis_rcpp_mcem_async", (DL_FUNC) &_remphasis_rcpp_mcem_async, 27},
+    {"_remphasis_rcpp_tree_pool", (DL_FUNC) &_remphasis_rcpp_tree_pool, 0},
+    {"_remphasis_rcpp_mcm", (DL_FUNC) &_remphasis_rcpp_mcm, 11},
+    {"_remphasis_rcpp_q", (DL_FUNC) &_remphasis_rcpp_q, 5},
+    {"_remphasis_rcpp_adapt_proposal", (DL_FUNC) &_remphasis_rcpp_adapt_proposal, 7},
+    {"_remphasis_rcpp_saem", (DL_FUNC) &_remphasis_rcpp_saem, 24},
+    {"_remphasis_rcpp_e_shard", (DL_FUNC) &_remphasis_rcpp_e_shard, 13},
+    {"_remphasis_rcpp_e_merge", (DL_FUNC) &_remphasis_rcpp_e_merge, 2},
+    {"_remphasis_rcpp_survival", (DL_FUNC) &_remphasis_rcpp_survival, 8},
     {NULL, NULL, 0}
 };
 
@@ -3,12 +3,14 @@
 #include <algorithm>
 #include <stdexcept>
 #include <atomic>
-#include <tuple>
 #include <memory>
+#include <vector>
 #include "plugin.hpp"
 #include "augment_tree.hpp"
 #include "model_helpers.hpp"
-#include "sbplx.hpp"
+#include "state_guard.hpp"
+#include "envelope_cache.hpp"
+#include "maximize_1d.hpp"
 
 
 namespace emphasis {
@@ -32,40 +34,43 @@ namespace emphasis {
     }
 
 
-    class maximize_lambda
+    // thinning bound of the speciation rate on [t0, t1]
+    double maximize_lambda(double t0, double t1, const param_t& pars, const tree_t& tree, const Model& model, void** state)
     {
-      using ml_state = std::tuple<const param_t&, const tree_t&, const Model&>;
+      auto rate = [&](double t) { return std::max(0.0, model.nh_rate_state(state, t, pars, tree)); };
+      const double lambda = detail::maximize_1d(rate, t0, t1, EMPHASIS_LAMBDA_MAX_EVALS, EMPHASIS_LAMBDA_XTOL_REL);
+      return (1.0 + EMPHASIS_LAMBDA_SAFETY_MARGIN) * lambda;
+    }
 
-      static double dx(unsigned int n, const double* x, double*, void* func_data)
-      {
-        auto ml = *reinterpret_cast<ml_state*>(func_data);
-        return std::max(0.0, std::get<2>(ml).nh_rate(*x, std::get<0>(ml), std::get<1>(ml)));
-      }
 
+    auto thread_local uniform = detail::uniform_buffer<detail::reng_t>(detail::random_stream());
+
+
+    // thinning uniforms in (0, 1]
+    class thinning_uniforms
+    {
     public:
-      explicit maximize_lambda() : nlopt_() {}
+      explicit thinning_uniforms(const augment_stream_t& stream) : stream_(stream)
+      {
+        detail::random_stream().seed(stream.seed);    // shared with the plugin
+        uniform.reset();
+      }
 
-      double operator()(double t0, double t1, const param_t& pars, tree_t& tree, const Model& model)
+      double operator()()
       {
-        auto x0 = std::min(t0, t1);
-        auto x1 = std::max(t0, t1);
-        nlopt_.set_lower_bounds(x0);
-        nlopt_.set_upper_bounds(x1);
-        nlopt_.set_xtol_rel(0.0001);
-        ml_state mls(pars, tree, model);
-        nlopt_.set_max_objective(dx, &mls);
-        return nlopt_.optimize(x0);
+        if (stream_.qmc && (dim_ < stream_.qmc->dims())) {
+          return (*stream_.qmc)(stream_.point, dim_++);
+        }
+        const double u = uniform();
+        return stream_.antithetic ? (1.0 - u) + (1.0 / 9007199254740992.0) : u;
       }
 
     private:
-      sbplx_1 nlopt_;
+      const augment_stream_t& stream_;
+      unsigned dim_ = 0;
     };
 
 
-    auto thread_local reng = detail::make_random_engine<std::default_random_engine>();
-    maximize_lambda thread_local tlml;
-
-
     double get_next_bt(const tree_t& tree, double cbt)
     {
       auto it = std::upper_bound(tree.cbegin(), tree.cend(), cbt, detail::node_less{});
@@ -74,9 +79,9 @@ namespace emphasis {
 
 
     // insert speciation node_t before t_spec,
-    // inserts extinction node_t before t_ext
-    // and tracks n
-    void insert_species(double t_spec, double t_ext, tree_t& tree)
+    // inserts extinction node_t before t_ext,
+    // tracks n and invalidates the model state
+    void insert_species(double t_spec, double t_ext, tree_t& tree, state_guard& state)
     {
       auto n_after = [](tree_t::iterator it) { 
         const auto to = detail::is_extinction(*it) ? -1.0 : 1.0;
@@ -91,44 +96,56 @@ namespace emphasis {
         first->n = n_after(first - 1);
       }
       make_extinct_node(tree.emplace(first), t_ext, n_after(first - 1));
+      state.invalidate_state(t_spec, t_ext);
     }
 
 
-    void do_augment_tree(const param_t& pars, tree_t& tree, const Model& model, int max_missing, double max_lambda)
+    augment_result_t do_augment_tree(const param_t& pars, tree_t& tree, const Model& model, int max_missing, double max_lambda, thinning_uniforms& uniform, const deadline_t* deadline)
     {
       double cbt = 0;
       tree.reserve(5 * tree.size());    // just a guess, should cover most 'normal' cases
       int num_missing_branches = 0;
       const double b = tree.back().brts;
-      auto& ml = tlml;
+      detail::envelope_cache envelope;
+      state_guard state(&model);
+      auto maximize = [&](double t0, double t1) { return maximize_lambda(t0, t1, pars, tree, model, state); };
       while (cbt < b) {
+        if (deadline && deadline->expired()) return { augment_status_t::cancelled, cbt };
+        state.advance(cbt, tree);
         double next_bt = get_next_bt(tree, cbt);
-        double lambda_max = ml(cbt, next_bt, pars, tree, model);
-        if (lambda_max > max_lambda) throw augmentation_lambda{};
-        double u1 = std::uniform_real_distribution<>()(reng);
+        const auto& piece = envelope.at(cbt, next_bt, maximize);
+        const double lambda_max = piece.bound;
+        const double piece_end = piece.t1;
+        if (lambda_max > max_lambda) return { augment_status_t::lambda, cbt };
+        double u1 = uniform();
         double next_speciation_time = cbt - std::log(u1) / lambda_max;
-        if (next_speciation_time < next_bt) {
-          double u2 = std::uniform_real_distribution<>()(reng);
+        if (next_speciation_time < piece_end) {
+          double u2 = uniform();
           // calc pd(next_speciation_time)
-          double pt = std::max(0.0, model.nh_rate(next_speciation_time, pars, tree)) / lambda_max;
+          double pt = std::max(0.0, model.nh_rate_state(state, next_speciation_time, pars, tree)) / lambda_max;
           if (u2 < pt) {
             double extinction_time = model.extinction_time(next_speciation_time, pars, tree);
-            insert_species(next_speciation_time, extinction_time, tree);
+            insert_species(next_speciation_time, extinction_time, tree, state);
+            envelope.invalidate(next_speciation_time);
             num_missing_branches++;
             if (num_missing_branches > max_missing) {
-              throw augmentation_overrun{};
+              return { augment_status_t::overrun, next_speciation_time };
             }
           }
+          else {
+            envelope.reject(pt);
+          }
         }
-        cbt = std::min(next_speciation_time, next_bt);
+        cbt = std::min(next_speciation_time, piece_end);
       }
       for (auto& node : tree) {
         node.pd = detail::calculate_pd(node.brts, static_cast<unsigned>(tree.size()), tree.data());
       }
+      return { augment_status_t::accepted, b };
     }
 
 
-    void do_augment_tree_cont(const param_t& pars, tree_t& tree, const Model& model, int max_missing, double max_lambda)
+    augment_result_t do_augment_tree_cont(const param_t& pars, tree_t& tree, const Model& model, int max_missing, double max_lambda, thinning_uniforms& uniform, const deadline_t* deadline)
     {
       double cbt = 0;
       tree.reserve(5 * tree.size());    // just a guess, should cover most 'normal' cases
@@ -136,24 +153,27 @@ namespace emphasis {
       const double b = tree.back().brts;
       double lambda2 = 0.0;
       bool dirty = true;
+      state_guard state(&model);
       while (cbt < b) {
+        if (deadline && deadline->expired()) return { augment_status_t::cancelled, cbt };
+        state.advance(cbt, tree);
         double next_bt = get_next_bt(tree, cbt);
-        double lambda1 = (!dirty) ? lambda2 : std::max(0.0, model.nh_rate(cbt, pars, tree));
-        lambda2 = std::max(0.0, model.nh_rate(next_bt, pars, tree));
+        double lambda1 = (!dirty) ? lambda2 : std::max(0.0, model.nh_rate_state(state, cbt, pars, tree));
+        lambda2 = std::max(0.0, model.nh_rate_state(state, next_bt, pars, tree));
         double lambda_max = std::max<double>(lambda1, lambda2);
-        if (lambda_max > max_lambda) throw augmentation_lambda{};
-        double u1 = std::uniform_real_distribution<>()(reng);
+        if (lambda_max > max_lambda) return { augment_status_t::lambda, cbt };
+        double u1 = uniform();
         double next_speciation_time = cbt - std::log(u1) / lambda_max;
         dirty = false;
         if (next_speciation_time < next_bt) {
-          double u2 = std::uniform_real_distribution<>()(reng);
-          double pt = std::max(0.0, model.nh_rate(next_speciation_time, pars, tree)) / lambda_max;
+          double u2 = uniform();
+          double pt = std::max(0.0, model.nh_rate_state(state, next_speciation_time, pars, tree)) / lambda_max;
           if (u2 < pt) {
             double extinction_time = model.extinction_time(next_speciation_time, pars, tree);
-            insert_species(next_speciation_time, extinction_time, tree);
+            insert_species(next_speciation_time, extinction_time, tree, state);
             num_missing_branches++;
             if (num_missing_branches > max_missing) {
-              throw augmentation_overrun{};
+              return { augment_status_t::overrun, next_speciation_time };
             }
             dirty = true;   // tree changed
           }
@@ -163,21 +183,21 @@ namespace emphasis {
       for (auto& node : tree) {
         node.pd = detail::calculate_pd(node.brts, static_cast<unsigned>(tree.size()), tree.data());
       }
+      return { augment_status_t::accepted, b };
     }
 
   } // namespace augment
 
 
-  void augment_tree(const param_t& pars, const tree_t& input_tree, Model* model, int max_missing, double max_lambda, tree_t& pooled)
+  augment_result_t augment_tree(const param_t& pars, const tree_t& input_tree, Model* model, int max_missing, double max_lambda, tree_t& pooled, const augment_stream_t& stream, const deadline_t* deadline)
   {
+    thinning_uniforms uniform(stream);
     pooled.resize(input_tree.size());
     std::copy(input_tree.cbegin(), input_tree.cend(), pooled.begin());
     if (model->numerical_max_lambda()) {
-      do_augment_tree(pars, pooled, *model, max_missing, max_lambda);
-    }
-    else {
-      do_augment_tree_cont(pars, pooled, *model, max_missing, max_lambda);
+      return do_augment_tree(pars, pooled, *model, max_missing, max_lambda, uniform, deadline);
     }
+    return do_augment_tree_cont(pars, pooled, *model, max_missing, max_lambda, uniform, deadline);
   }
 
 
@@ -0,0 +1,150 @@
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <tbb/tbb.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "qmc.hpp"
+#include "model_helpers.hpp"
+#include "gelman_rubin.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    constexpr int min_diagnostic_rows = 4;    // per chain
+    constexpr double min_spread_scale = 0.01; // of the starting points, parameters near 0 are spread too
+
+
+    // pools the chains over the trailing half of their post burn-in rows.
+    // returns true if R-hat is below max_rhat throughout
+    bool diagnose(chains_t& C, const std::vector<param_t>& theta, int burnin, double max_rhat)
+    {
+      size_t last = std::numeric_limits<size_t>::max();
+      for (const auto& h : C.history) last = std::min(last, h.size());
+      const size_t b = std::min(last, static_cast<size_t>(std::max(0, burnin)));
+      const size_t first = b + (last - b) / 2;
+      const size_t nparams = theta.front().size();
+      if (last - first < static_cast<size_t>(min_diagnostic_rows)) {
+        // too few rows, mean of the current estimates
+        C.estimates.assign(nparams, 0.0);
+        for (const auto& t : theta) {
+          for (size_t j = 0; j < nparams; ++j) C.estimates[j] += t[j] / static_cast<double>(theta.size());
+        }
+        C.se.assign(nparams, std::numeric_limits<double>::infinity());
+        C.rhat.assign(nparams, std::numeric_limits<double>::infinity());
+        C.fhat_se = C.fhat_rhat = std::numeric_limits<double>::infinity();
+        return false;
+      }
+      const auto f = detail::gelman_rubin(C.history, first, last, [](const fit_history_t& h, size_t i) { return h.fhat[i]; });
+      C.fhat = f.mean;
+      C.fhat_se = f.se;
+      C.fhat_rhat = f.rhat;
+      bool converged = (f.rhat < max_rhat);
+      C.estimates.resize(nparams);
+      C.se.resize(nparams);
+      C.rhat.resize(nparams);
+      for (size_t j = 0; j < nparams; ++j) {
+        const auto d = detail::gelman_rubin(C.history, first, last, [j](const fit_history_t& h, size_t i) { return h.row(i)[j]; });
+        C.estimates[j] = d.mean;
+        C.se[j] = d.se;
+        C.rhat[j] = d.rhat;
+        converged = converged && (d.rhat < max_rhat);
+      }
+      return converged;
+    }
+
+
+    // starting point of chain k, chain 0 starts at pars
+    param_t dispersed(const param_t& pars, size_t k, uint64_t chain_seed, double dispersion, const param_t& lower, const param_t& upper)
+    {
+      param_t x = pars;
+      if (k == 0) return x;
+      for (size_t j = 0; j < x.size(); ++j) {
+        const double u = static_cast<double>(detail::stream_seed(chain_seed, ~uint64_t(j)) >> 11) * (1.0 / 9007199254740992.0);
+        x[j] += dispersion * std::max(std::abs(pars[j]), min_spread_scale) * (2.0 * u - 1.0);
+        if (j < lower.size()) x[j] = std::max(x[j], lower[j]);
+        if (j < upper.size()) x[j] = std::min(x[j], upper[j]);
+      }
+      return x;
+    }
+
+  }
+
+
+  chains_t mcem_chains(int N,
+                       int maxN,
+                       const param_t& pars,
+                       const brts_t& brts,
+                       class Model* model,
+                       int soc,
+                       int max_missing,
+                       double max_lambda,
+                       const param_t& lower_bound,
+                       const param_t& upper_bound,
+                       double xtol_rel,
+                       int num_threads,
+                       conditional_fun_t* conditional,
+                       const chains_control_t& control,
+                       const deadline_t* deadline)
+  {
+    if (control.chains < 2) throw emphasis_error("mcem_chains requires at least two chains");
+    if (!model->is_threadsafe()) num_threads = 1;
+    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+    auto T0 = std::chrono::high_resolution_clock::now();
+    const size_t K = static_cast<size_t>(control.chains);
+    auto C = chains_t{};
+    C.seed = control.sampler.seed ? control.sampler.seed : detail::make_random_engine<detail::reng_t>()();
+    const auto lower = lower_bound.empty() ? model->lower_bound() : lower_bound;
+    const auto upper = upper_bound.empty() ? model->upper_bound() : upper_bound;
+    std::vector<uint64_t> chain_seed(K);
+    std::vector<param_t> theta(K);
+    std::vector<run_status_t> status(K, run_status_t::completed);
+    for (size_t k = 0; k < K; ++k) {
+      chain_seed[k] = detail::stream_seed(C.seed, k);
+      theta[k] = dispersed(pars, k, chain_seed[k], control.dispersion, lower, upper);
+      C.history.emplace_back(static_cast<int>(pars.size()), control.max_iterations);
+    }
+    while ((C.iterations < control.max_iterations) && (C.status == run_status_t::completed)) {
+      const int round = std::min(std::max(1, control.check_interval), control.max_iterations - C.iterations);
+      tbb::task_group chains;
+      for (size_t k = 0; k < K; ++k) {
+        chains.run([&, k]() {
+          for (int r = 0; r < round; ++r) {
+            const int i = C.iterations + r;
+            auto sampler = control.sampler;
+            sampler.seed = detail::stream_seed(chain_seed[k], static_cast<uint64_t>(i));   // fresh streams per E-step
+            auto EM = mcem(N, maxN, theta[k], brts, model, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads,
+                           conditional, nullptr, 0.0, sampler, control.optimizer, control.compact, deadline, control.minibatch, control.prune);
+            if (EM.m.status != run_status_t::completed) {
+              status[k] = EM.m.status;    // drop the incomplete iteration
+              break;
+            }
+            theta[k] = EM.m.estimates;
+            C.history[k].push_back(theta[k], EM.e.fhat, N, (i < control.burnin) ? 1 : 3);
+          }
+        });
+      }
+      chains.wait();
+      for (auto s : status) {
+        if (s != run_status_t::completed) C.status = s;
+      }
+      if (C.status != run_status_t::completed) break;
+      C.iterations += round;
+      C.converged = diagnose(C, theta, control.burnin, control.max_rhat);
+      if (C.converged) break;
+    }
+    if (C.status != run_status_t::completed) {
+      // partial result over the common rows
+      C.iterations = static_cast<int>(std::min_element(C.history.cbegin(), C.history.cend(), [](const fit_history_t& a, const fit_history_t& b) { return a.size() < b.size(); })->size());
+      diagnose(C, theta, control.burnin, control.max_rhat);
+    }
+    auto T1 = std::chrono::high_resolution_clock::now();
+    C.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+    return C;
+  }
+
+}
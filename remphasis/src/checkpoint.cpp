@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <fstream>
+#include "checkpoint.hpp"
+#include "delta_tree.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    const char magic[8] = { 'E', 'M', 'P', 'C', 'K', 'P', 'T', '1' };
+
+    enum storage : uint8_t { expanded = 0, compact, replay };
+
+
+    class writer
+    {
+    public:
+      explicit writer(const std::string& file) : os_(file, std::ios::binary | std::ios::trunc)
+      {
+        if (!os_) throw emphasis_error("can't open checkpoint file " + file);
+      }
+
+      template <typename T>
+      void put(const T& x) { os_.write(reinterpret_cast<const char*>(&x), sizeof(T)); }
+
+      template <typename T>
+      void put(const std::vector<T>& v)
+      {
+        put(static_cast<uint64_t>(v.size()));
+        os_.write(reinterpret_cast<const char*>(v.data()), sizeof(T) * v.size());
+      }
+
+      void close()
+      {
+        os_.close();
+        if (!os_) throw emphasis_error("writing checkpoint failed");
+      }
+
+    private:
+      std::ofstream os_;
+    };
+
+
+    class reader
+    {
+    public:
+      explicit reader(std::ifstream& is) : is_(is) {}
+
+      template <typename T>
+      T get()
+      {
+        T x;
+        is_.read(reinterpret_cast<char*>(&x), sizeof(T));
+        if (!is_) throw emphasis_error("truncated checkpoint file");
+        return x;
+      }
+
+      template <typename T>
+      void get(std::vector<T>& v)
+      {
+        v.resize(static_cast<size_t>(get<uint64_t>()));
+        is_.read(reinterpret_cast<char*>(v.data()), sizeof(T) * v.size());
+        if (!is_) throw emphasis_error("truncated checkpoint file");
+      }
+
+    private:
+      std::ifstream& is_;
+    };
+
+  }
+
+
+  void write_checkpoint(const std::string& file,
+                        uint64_t digest,
+                        uint64_t seed,
+                        const fit_history_t& history,
+                        const tree_pool_t* pool,
+                        const proposal_t& proposal)
+  {
+    const std::string tmp = file + ".tmp";
+    writer w(tmp);
+    for (auto c : magic) w.put(c);
+    w.put(digest);
+    w.put(seed);
+    w.put(static_cast<int32_t>(history.nparams));
+    w.put(history.pars);
+    w.put(history.fhat);
+    w.put(history.sample_size);
+    w.put(history.phase);
+    w.put(static_cast<uint8_t>(pool != nullptr));
+    if (pool) {
+      const auto type = !pool->replay.empty() ? storage::replay : (!pool->deltas.empty() ? storage::compact : storage::expanded);
+      w.put(type);
+      w.put(static_cast<int32_t>(pool->rejected));
+      w.put(static_cast<int32_t>(pool->recycled));
+      w.put(pool->logg);
+      if (type == storage::replay) {
+        // the inputs of the E-step, trees are regenerated on resume
+        const auto spec = replay_spec(pool->replay);
+        w.put(spec.pars);
+        w.put(static_cast<int32_t>(spec.sampler.type));
+        w.put(static_cast<int32_t>(spec.sampler.replicates));
+        w.put(spec.sampler.seed);
+        w.put(static_cast<uint64_t>(spec.sampler.proposal.pars.size()));
+        for (const auto& q : spec.sampler.proposal.pars) w.put(q);
+        w.put(spec.sampler.proposal.weights);
+        w.put(spec.sampler.proposal.defensive);
+        w.put(static_cast<int32_t>(spec.sampler.replay_cache));
+        w.put(spec.backbone);
+        w.put(static_cast<int32_t>(spec.max_missing));
+        w.put(spec.max_lambda);
+        w.put(spec.index);
+      }
+      else if (type == storage::compact) {
+        w.put(pool->deltas.backbone());
+        tree_t tree;
+        for (size_t i = 0; i < pool->deltas.size(); ++i) {
+          pool->deltas.expand(i, tree);
+          w.put(tree);
+        }
+      }
+      else {
+        for (const auto& tree : pool->trees) w.put(tree);
+      }
+    }
+    w.put(static_cast<uint64_t>(proposal.pars.size()));
+    for (const auto& q : proposal.pars) w.put(q);
+    w.put(proposal.weights);
+    w.put(proposal.defensive);
+    w.close();
+#ifdef _WIN32
+    // rename doesn't replace an existing file here
+    std::remove(file.c_str());
+#endif
+    if (std::rename(tmp.c_str(), file.c_str())) {
+      throw emphasis_error("can't rename checkpoint file " + tmp);
+    }
+  }
+
+
+  bool read_checkpoint(const std::string& file, fit_checkpoint_t& cp)
+  {
+    std::ifstream is(file, std::ios::binary);
+    if (!is) return false;
+    reader r(is);
+    for (auto c : magic) {
+      if (r.get<char>() != c) throw emphasis_error("not a checkpoint file: " + file);
+    }
+    cp = fit_checkpoint_t{};
+    cp.digest = r.get<uint64_t>();
+    cp.seed = r.get<uint64_t>();
+    cp.history.nparams = r.get<int32_t>();
+    r.get(cp.history.pars);
+    r.get(cp.history.fhat);
+    r.get(cp.history.sample_size);
+    r.get(cp.history.phase);
+    const size_t rows = cp.history.fhat.size();
+    if ((cp.history.pars.size() != rows * cp.history.nparams) || (cp.history.sample_size.size() != rows) || (cp.history.phase.size() != rows)) {
+      throw emphasis_error("malformed checkpoint file: " + file);
+    }
+    cp.has_pool = (0 != r.get<uint8_t>());
+    if (cp.has_pool) {
+      const auto type = r.get<uint8_t>();
+      if (type > storage::replay) {
+        throw emphasis_error("malformed checkpoint file: " + file);
+      }
+      const bool compact = (type == storage::compact);
+      cp.pool.rejected = r.get<int32_t>();
+      cp.pool.recycled = r.get<int32_t>();
+      r.get(cp.pool.logg);
+      if (type == storage::replay) {
+        auto& spec = cp.replay;
+        r.get(spec.pars);
+        spec.sampler.type = static_cast<sampler_t>(r.get<int32_t>());
+        spec.sampler.replicates = r.get<int32_t>();
+        spec.sampler.seed = r.get<uint64_t>();
+        spec.sampler.proposal.pars.resize(static_cast<size_t>(r.get<uint64_t>()));
+        for (auto& q : spec.sampler.proposal.pars) r.get(q);
+        r.get(spec.sampler.proposal.weights);
+        spec.sampler.proposal.defensive = r.get<double>();
+        spec.sampler.replay = true;
+        spec.sampler.replay_cache = r.get<int32_t>();
+        r.get(spec.backbone);
+        spec.max_missing = r.get<int32_t>();
+        spec.max_lambda = r.get<double>();
+        r.get(spec.index);
+        if (spec.index.size() != cp.pool.logg.size()) {
+          throw emphasis_error("malformed checkpoint file: " + file);
+        }
+      }
+      tree_t tree;
+      if (compact) {
+        r.get(tree);
+        cp.pool.deltas = delta_trees(tree);
+      }
+      for (size_t i = 0; (type != storage::replay) && (i < cp.pool.logg.size()); ++i) {
+        r.get(tree);
+        if (compact) {
+          cp.pool.deltas.push_back(tree);
+        }
+        else {
+          cp.pool.trees.push_back(tree);
+        }
+      }
+    }
+    cp.proposal.pars.resize(static_cast<size_t>(r.get<uint64_t>()));
+    for (auto& q : cp.proposal.pars) r.get(q);
+    r.get(cp.proposal.weights);
+    cp.proposal.defensive = r.get<double>();
+    return true;
+  }
+
+}
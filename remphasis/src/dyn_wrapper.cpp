@@ -1,4 +1,8 @@
 #include <cmath>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 #include "plugin.hpp"
 #include "emphasis.hpp"
 #include "model_helpers.hpp"
@@ -16,7 +20,7 @@ namespace emphasis {
   namespace {
 
     template <typename Fun>
-    inline double wrap(Fun&& fun, const param_t& pars, const tree_t& tree)
+    inline auto wrap(Fun&& fun, const param_t& pars, const tree_t& tree)
     {
       return fun(pars.data(), static_cast<unsigned>(tree.size()), reinterpret_cast<const emp_node_t*>(tree.data()));
     }
@@ -33,8 +37,9 @@ namespace emphasis {
   class dyn_model_t : public Model
   {
   public:
-    dyn_model_t(const std::string& DLL)
-    : dynlib_(DLL)
+    // isolated: loads a private copy of DLL
+    dyn_model_t(const std::string& DLL, bool isolated = false)
+    : dynlib_(DLL, isolated)
     {
       emp_local_load_address(description, true);
       emp_local_load_address(is_threadsafe, true);
@@ -44,8 +49,23 @@ namespace emphasis {
       emp_local_load_address(nh_rate, false);
       emp_local_load_address(sampling_prob, false);
       emp_local_load_address(loglik, false);
+      emp_local_load_address(log_weight, true);
+      emp_local_load_address(bd_rates, true);
       emp_local_load_address(lower_bound, true);
       emp_local_load_address(upper_bound, true);
+      emp_local_load_address(create_state, true);
+      emp_local_load_address(free_state, true);
+      emp_local_load_address(invalidate_state, true);
+      emp_local_load_address(advance_state, true);
+      emp_local_load_address(nh_rate_state, true);
+      if (nh_rate_state_ && !(create_state_ && free_state_)) {
+        throw emphasis_error("emp_nh_rate_state requires emp_create_state and emp_free_state");
+      }
+      emp_local_load_address(set_random_stream, true);
+      if (set_random_stream_) {
+        // share our random stream with the plugin
+        set_random_stream_(detail::random_stream_accessor());
+      }
     }
 
     ~dyn_model_t() override {}
@@ -86,6 +106,50 @@ namespace emphasis {
       return wrap(loglik_, pars, tree);
     }
 
+    double log_weight(const param_t& pars, const tree_t& tree, double& logf, double& logg) const override {
+      if (nullptr == log_weight_) {
+        return Model::log_weight(pars, tree, logf, logg);
+      }
+      return log_weight_(pars.data(), static_cast<unsigned>(tree.size()), tree.data(), &logf, &logg);
+    }
+
+    bool bd_rates(double t, const param_t& pars, double n, double pd, double* rates) const override {
+      if (nullptr == bd_rates_) {
+        return false;
+      }
+      bd_rates_(t, pars.data(), n, pd, rates);
+      return true;
+    }
+
+    double nh_rate_state(void** state, double t, const param_t& pars, const tree_t& tree) const override {
+      if (nullptr == nh_rate_state_) {
+        return nh_rate(t, pars, tree);
+      }
+      if (nullptr == *state) {
+        *state = wrap(create_state_, pars, tree);
+      }
+      return nh_rate_state_(*state, t, pars.data(), static_cast<unsigned>(tree.size()), tree.data());
+    }
+
+    void advance_state(void** state, double t, const tree_t& tree) const override {
+      if (*state && advance_state_) {
+        advance_state_(*state, t, static_cast<unsigned>(tree.size()), tree.data());
+      }
+    }
+
+    void invalidate_state(void** state, double t0, double t1) const override {
+      if (*state && invalidate_state_) {
+        invalidate_state_(*state, t0, t1);
+      }
+    }
+
+    void free_state(void** state) const override {
+      if (*state && free_state_) {
+        free_state_(*state);
+      }
+      *state = nullptr;
+    }
+
     param_t lower_bound() const override
     {
       if (lower_bound_) {
@@ -107,34 +171,131 @@ namespace emphasis {
     }
 
   private:
-    static emp_description_func description_;
-    static emp_is_threadsafe_func is_threadsafe_;
-    static emp_numerical_max_lambda_func numerical_max_lambda_;
-    static emp_nparams_func nparams_;
-    static emp_extinction_time_func extinction_time_;
-    static emp_nh_rate_func nh_rate_;
-    static emp_sampling_prob_func sampling_prob_;
-    static emp_loglik_func loglik_;
-    static emp_lower_bound_func lower_bound_;
-    static emp_upper_bound_func upper_bound_;
+    emp_description_func description_ = nullptr;
+    emp_is_threadsafe_func is_threadsafe_ = nullptr;
+    emp_numerical_max_lambda_func numerical_max_lambda_ = nullptr;
+    emp_nparams_func nparams_ = nullptr;
+    emp_extinction_time_func extinction_time_ = nullptr;
+    emp_nh_rate_func nh_rate_ = nullptr;
+    emp_sampling_prob_func sampling_prob_ = nullptr;
+    emp_loglik_func loglik_ = nullptr;
+    emp_log_weight_func log_weight_ = nullptr;
+    emp_bd_rates_func bd_rates_ = nullptr;
+    emp_lower_bound_func lower_bound_ = nullptr;
+    emp_upper_bound_func upper_bound_ = nullptr;
+    emp_create_state_func create_state_ = nullptr;
+    emp_free_state_func free_state_ = nullptr;
+    emp_invalidate_state_func invalidate_state_ = nullptr;
+    emp_advance_state_func advance_state_ = nullptr;
+    emp_nh_rate_state_func nh_rate_state_ = nullptr;
+    emp_set_random_stream_func set_random_stream_ = nullptr;
     dll::dynlib dynlib_;
   };
 
-  emp_description_func dyn_model_t::description_ = nullptr;
-  emp_is_threadsafe_func dyn_model_t::is_threadsafe_ = nullptr;
-  emp_numerical_max_lambda_func dyn_model_t::numerical_max_lambda_ = nullptr;
-  emp_nparams_func dyn_model_t::nparams_ = nullptr;
-  emp_extinction_time_func dyn_model_t::extinction_time_ = nullptr;
-  emp_nh_rate_func dyn_model_t::nh_rate_ = nullptr;
-  emp_sampling_prob_func dyn_model_t::sampling_prob_ = nullptr;
-  emp_loglik_func dyn_model_t::loglik_ = nullptr;
-  emp_lower_bound_func dyn_model_t::lower_bound_ = nullptr;
-  emp_upper_bound_func dyn_model_t::upper_bound_ = nullptr;
+  // thread-safe front of a non-thread-safe plugin.
+  // Every calling thread is bound to its own instance of the plugin,
+  // loaded from a private copy of the DLL on first use.
+  class isolated_model_t : public Model
+  {
+  public:
+    isolated_model_t(const std::string& DLL) : DLL_(DLL), id_(++instances_created())
+    {
+      local();
+    }
+
+    ~isolated_model_t() override {}
+
+    const char* description() const override { return local()->description(); }
+    bool is_threadsafe() const override { return true; }
+    bool numerical_max_lambda() const override { return local()->numerical_max_lambda(); }
+    int nparams() const override { return local()->nparams(); }
+
+    double extinction_time(double t_speciation, const param_t& pars, const tree_t& tree) const override {
+      return local()->extinction_time(t_speciation, pars, tree);
+    }
+
+    double nh_rate(double t, const param_t& pars, const tree_t& tree) const override {
+      return local()->nh_rate(t, pars, tree);
+    }
+
+    double sampling_prob(const param_t& pars, const tree_t& tree) const override {
+      return local()->sampling_prob(pars, tree);
+    }
+
+    double loglik(const param_t& pars, const tree_t& tree) const override {
+      return local()->loglik(pars, tree);
+    }
+
+    double log_weight(const param_t& pars, const tree_t& tree, double& logf, double& logg) const override {
+      return local()->log_weight(pars, tree, logf, logg);
+    }
+
+    bool bd_rates(double t, const param_t& pars, double n, double pd, double* rates) const override {
+      return local()->bd_rates(t, pars, n, pd, rates);
+    }
+
+    double nh_rate_state(void** state, double t, const param_t& pars, const tree_t& tree) const override {
+      return local()->nh_rate_state(state, t, pars, tree);
+    }
+
+    void advance_state(void** state, double t, const tree_t& tree) const override {
+      local()->advance_state(state, t, tree);
+    }
+
+    void invalidate_state(void** state, double t0, double t1) const override {
+      local()->invalidate_state(state, t0, t1);
+    }
+
+    void free_state(void** state) const override {
+      local()->free_state(state);
+    }
+
+    param_t lower_bound() const override { return local()->lower_bound(); }
+    param_t upper_bound() const override { return local()->upper_bound(); }
+
+  private:
+    static std::atomic<uint64_t>& instances_created()
+    {
+      static std::atomic<uint64_t> n{ 0 };
+      return n;
+    }
+
+    // the calling thread's instance
+    const Model* local() const
+    {
+      struct binding_t { uint64_t id; const Model* model; };
+      static thread_local binding_t binding{ 0, nullptr };
+      if (binding.id != id_) {
+        std::lock_guard<std::mutex> _(mutex_);
+        auto& model = models_[std::this_thread::get_id()];
+        if (!model) {
+          model.reset(new dyn_model_t(DLL_, true));
+        }
+        binding = { id_, model.get() };
+      }
+      return binding.model;
+    }
+
+    const std::string DLL_;
+    const uint64_t id_;
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::thread::id, std::unique_ptr<dyn_model_t>> models_;
+  };
+
+
+  std::unique_ptr<emphasis::Model> create_plugin_model(const std::string& DLL, bool isolated)
+  {
+    auto model = std::unique_ptr<emphasis::Model>(new emphasis::dyn_model_t(DLL));
+    if (isolated && !model->is_threadsafe()) {
+      return detail::create_isolated_plugin_model(DLL);
+    }
+    return model;
+  }
 
 
-  std::unique_ptr<emphasis::Model> create_plugin_model(const std::string& DLL)
+  std::unique_ptr<emphasis::Model> detail::create_isolated_plugin_model(const std::string& DLL)
   {
-    return std::unique_ptr<emphasis::Model>(new emphasis::dyn_model_t(DLL));
+    return std::unique_ptr<emphasis::Model>(new emphasis::isolated_model_t(DLL));
   }
 
 }
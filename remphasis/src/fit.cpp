@@ -0,0 +1,334 @@
+#include <cmath>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "qmc.hpp"
+#include "model_helpers.hpp"
+#include "checkpoint.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    constexpr int max_sample_size = 10000000;   // upper bound of the required sample size
+
+
+    struct fit_args
+    {
+      const brts_t& brts;
+      Model* model;
+      int soc;
+      int max_missing;
+      double max_lambda;
+      const param_t& lower_bound;
+      const param_t& upper_bound;
+      double xtol_rel;
+      int num_threads;
+      conditional_fun_t* conditional;
+      const fit_control_t& control;
+      const fit_callback_t& callback;
+      const deadline_t* deadline;
+      uint64_t seed;                    // master seed
+      uint64_t digest;
+      fit_checkpoint_t* resume;         // replayed
+      mutable size_t checkpointed;      // rows in the last checkpoint
+    };
+
+
+    // FNV-1a over the inputs that determine the iterations of fit
+    class digest_t
+    {
+    public:
+      template <typename T>
+      digest_t& operator<<(const T& x)
+      {
+        auto p = reinterpret_cast<const unsigned char*>(&x);
+        for (size_t i = 0; i < sizeof(T); ++i) h_ = (h_ ^ p[i]) * 0x100000001b3ull;
+        return *this;
+      }
+
+      template <typename T>
+      digest_t& operator<<(const std::vector<T>& v)
+      {
+        *this << v.size();
+        for (const auto& x : v) *this << x;
+        return *this;
+      }
+
+      uint64_t value() const noexcept { return h_; }
+
+    private:
+      uint64_t h_ = 0xcbf29ce484222325ull;
+    };
+
+
+    void checkpoint(const fit_t& F, const fit_args& A, const tree_pool_t& pool, const proposal_t& proposal)
+    {
+      write_checkpoint(A.control.checkpoint, A.digest, A.seed, F.history, (A.control.recycle_ess > 0.0) ? &pool : nullptr, proposal);
+      A.checkpointed = F.history.size();
+    }
+
+
+    bool stopped(const fit_t& F)
+    {
+      return F.truncated || (F.status != run_status_t::completed);
+    }
+
+
+    // SE of fhat over the trailing half of the rows [first, last)
+    double fhat_se(const fit_history_t& H, size_t first, size_t last)
+    {
+      const size_t n = last - first;
+      first += std::max(size_t(1), n / 2) - 1;
+      double sum = 0.0;
+      double sum2 = 0.0;
+      size_t m = 0;
+      for (size_t i = first; i < last; ++i) {
+        if (std::isfinite(H.fhat[i])) {
+          sum += H.fhat[i];
+          sum2 += H.fhat[i] * H.fhat[i];
+          ++m;
+        }
+      }
+      if (m < 2) return std::numeric_limits<double>::infinity();
+      const double mean = sum / m;
+      const double var = std::max(0.0, (sum2 - m * mean * mean) / (m - 1));
+      return std::sqrt(var / m);
+    }
+
+
+    // column means over the rows [first, last)
+    param_t mean_pars(const fit_history_t& H, size_t first, size_t last)
+    {
+      param_t m(H.nparams, 0.0);
+      for (size_t i = first; i < last; ++i) {
+        const double* row = H.row(i);
+        for (int j = 0; j < H.nparams; ++j) {
+          m[j] += row[j];
+        }
+      }
+      for (auto& x : m) x /= static_cast<double>(last - first);
+      return m;
+    }
+
+
+    // mcem iterations until the SE of fhat drops below control.em_tol.
+    // returns the first row of the chain in H
+    size_t mcem_chain(param_t& pars, int sample_size, int burnin, int phase, int metaiteration, int required, fit_t& F, const fit_args& A)
+    {
+      const size_t first = F.history.size();
+      auto pool = tree_pool_t{};
+      auto proposal = A.control.sampler.proposal;
+      double sde = 10;
+      int i = 0;
+      while (sde > A.control.em_tol) {
+        if (F.history.full()) {
+          F.truncated = true;
+          break;
+        }
+        ++i;
+        const size_t k = F.history.size();
+        const bool replay = A.resume && (k < A.resume->history.size());
+        double fhat = 0.0;
+        if (replay) {
+          // replay checkpointed iteration
+          const auto& H = A.resume->history;
+          if ((H.sample_size[k] != sample_size) || (H.phase[k] != phase)) {
+            throw emphasis_error("checkpoint doesn't match the fit");
+          }
+          pars.assign(H.row(k), H.row(k) + H.nparams);
+          fhat = H.fhat[k];
+          if ((k + 1 == H.size()) && A.resume->has_pool) {
+            pool = std::move(A.resume->pool);
+            if (!A.resume->replay.index.empty()) {
+              pool.replay = make_replay_trees(A.resume->replay, A.model);
+            }
+          }
+          if ((k + 1 == H.size()) && A.control.adapt_proposal) {
+            proposal = A.resume->proposal;
+          }
+          ++F.resumed;
+        }
+        else {
+          auto sampler = A.control.sampler;
+          sampler.seed = detail::stream_seed(A.seed, k);   // fresh streams per E-step
+          sampler.proposal = proposal;
+          auto EM = mcem(sample_size, 10 * sample_size, pars, A.brts, A.model, A.soc, A.max_missing, A.max_lambda,
+                         A.lower_bound, A.upper_bound, A.xtol_rel, A.num_threads, A.conditional,
+                         (A.control.recycle_ess > 0.0) ? &pool : nullptr, A.control.recycle_ess, sampler, A.control.optimizer, A.control.compact, A.deadline, A.control.minibatch, A.control.prune);
+          if (EM.m.status != run_status_t::completed) {
+            F.status = EM.m.status;   // drop the incomplete iteration
+            break;
+          }
+          pars = EM.m.estimates;
+          fhat = EM.e.fhat;
+          if (A.control.adapt_proposal) {
+            proposal = adapt_proposal(pars, EM.e, A.model, A.control.sampler.proposal.defensive, A.lower_bound, A.upper_bound, A.num_threads);
+          }
+        }
+        F.history.push_back(pars, fhat, sample_size, phase);
+        if (!replay && !A.control.checkpoint.empty() && (0 == F.history.size() % std::max(1, A.control.checkpoint_interval))) {
+          checkpoint(F, A, pool, proposal);
+        }
+        sde = (i > burnin) ? fhat_se(F.history, first, F.history.size()) : 10;
+        if (A.callback) {
+          A.callback(fit_progress_t{ phase, metaiteration, i, sample_size, required, fhat, (i > burnin) ? sde : 0.0, pars });
+        }
+      }
+      if (!A.control.checkpoint.empty() && stopped(F) && (A.checkpointed < F.history.size())) {
+        checkpoint(F, A, pool, proposal);
+      }
+      return first;
+    }
+
+
+    // Huber M-estimator of fhat ~ a + b / sample_size with inverse-variance
+    // weights sample_size, fitted by IRLS (as MASS::rlm with its defaults).
+    // returns the sample size required to estimate fhat within tol, clamped to
+    // [1, max_sample_size]; keeps current if the fit gives no usable size.
+    int required_sampling_size(const fit_history_t& H, size_t first, double tol, int current)
+    {
+      const size_t n = H.size() - first;
+      if (n < 3) throw emphasis_error("too few iterations to estimate the required sample size");
+      std::vector<double> x(n), y(n), w(n), r(n, 0.0), wr(n), hw(n, 1.0);
+      for (size_t i = 0; i < n; ++i) {
+        x[i] = 1.0 / H.sample_size[first + i];
+        y[i] = H.fhat[first + i];
+        w[i] = static_cast<double>(H.sample_size[first + i]);
+      }
+      double a = 0.0, b = 0.0;
+      auto wls = [&]() {
+        double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const double wi = w[i] * hw[i];
+          sw += wi; sx += wi * x[i]; sy += wi * y[i];
+          sxx += wi * x[i] * x[i]; sxy += wi * x[i] * y[i];
+        }
+        const double den = sw * sxx - sx * sx;
+        b = (den != 0.0) ? (sw * sxy - sx * sy) / den : 0.0;
+        a = (sy - b * sx) / sw;
+        double delta = 0.0, norm = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+          const double ri = y[i] - a - b * x[i];
+          delta += (ri - r[i]) * (ri - r[i]);
+          norm += r[i] * r[i];
+          r[i] = ri;
+        }
+        return std::sqrt(delta / std::max(1e-20, norm));
+      };
+      wls();
+      for (int iter = 0; iter < 20; ++iter) {
+        for (size_t i = 0; i < n; ++i) wr[i] = std::abs(r[i]) * std::sqrt(w[i]);
+        auto med = wr;
+        std::nth_element(med.begin(), med.begin() + n / 2, med.end());
+        double scale = med[n / 2];
+        if (0 == n % 2) {
+          scale = 0.5 * (scale + *std::max_element(med.begin(), med.begin() + n / 2));
+        }
+        scale /= 0.6745;
+        if (scale == 0.0) break;
+        for (size_t i = 0; i < n; ++i) {
+          const double u = wr[i] / scale;
+          hw[i] = (u <= 1.345) ? 1.0 : 1.345 / u;
+        }
+        if (wls() <= 1e-4) break;
+      }
+      const double f_r = a - tol;
+      const double n_r = b / (f_r - a);
+      if (!std::isfinite(n_r) || (n_r <= 0.0)) return current;
+      return static_cast<int>(std::ceil(std::min(n_r, static_cast<double>(max_sample_size))));
+    }
+
+  }
+
+
+  fit_t fit(const param_t& pars,
+            const brts_t& brts,
+            class Model* model,
+            int soc,
+            int max_missing,
+            double max_lambda,
+            const param_t& lower_bound,
+            const param_t& upper_bound,
+            double xtol_rel,
+            int num_threads,
+            conditional_fun_t* conditional,
+            const fit_control_t& control,
+            const fit_callback_t& callback,
+            const deadline_t* deadline)
+  {
+    auto T0 = std::chrono::high_resolution_clock::now();
+    digest_t digest;
+    digest << pars << brts << soc << max_missing << max_lambda << lower_bound << upper_bound << xtol_rel
+           << control.burnin_sample_size << control.pilot_sample_size << control.burnin_iterations
+           << control.pilot_burnin << control.meta_burnin << control.em_tol << control.sample_size_tol
+           << control.recycle_ess << control.sampler.type << control.sampler.replicates << control.optimizer
+           << control.compact << control.minibatch << control.prune.type << control.prune.threshold << control.prune.size;
+    if (control.adapt_proposal || !control.sampler.proposal.pars.empty()) {
+      const auto& p = control.sampler.proposal;
+      digest << control.adapt_proposal << p.defensive << p.weights << p.pars.size();
+      for (const auto& q : p.pars) digest << q;
+    }
+    fit_checkpoint_t resume;
+    const bool resuming = control.resume && !control.checkpoint.empty() && read_checkpoint(control.checkpoint, resume);
+    if (resuming && (resume.digest != digest.value())) {
+      throw emphasis_error("checkpoint doesn't match the fit");
+    }
+    uint64_t seed = resuming ? resume.seed : control.sampler.seed;
+    if (0 == seed) {
+      seed = detail::make_random_engine<detail::reng_t>()();
+    }
+    const fit_args A{ brts, model, soc, max_missing, max_lambda, lower_bound, upper_bound, xtol_rel, num_threads, conditional, control, callback, deadline,
+                      seed, digest.value(), resuming ? &resume : nullptr, resuming ? resume.history.size() : 0 };
+    auto F = fit_t{};
+    F.seed = seed;
+    F.history = fit_history_t(static_cast<int>(pars.size()), control.max_iterations);
+    auto theta = pars;
+
+    // phase 1: burn-in
+    mcem_chain(theta, control.burnin_sample_size, control.burnin_iterations, 1, 0, 0, F, A);
+    size_t n = F.history.size();
+    if (n) theta = mean_pars(F.history, n - (n + 1) / 2, n);
+
+    // phase 2: pilot runs
+    for (const int s : control.pilot_sample_size) {
+      if (stopped(F)) break;
+      const size_t rows = F.history.size();
+      const size_t first = mcem_chain(theta, s, control.pilot_burnin, 2, 0, 0, F, A);
+      n = F.history.size();
+      if (n > first) theta = mean_pars(F.history, std::max(first, n - std::min(n - first, (rows + 1) / 2)), n);
+    }
+    if (F.status != run_status_t::completed) {
+      // partial result: estimate from the last chain
+      F.estimates = theta;
+      auto T1 = std::chrono::high_resolution_clock::now();
+      F.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+      return F;
+    }
+
+    // phase 3: metaiterations
+    const size_t first_row = std::min(F.history.size(), static_cast<size_t>(control.burnin_iterations));
+    const int max_pilot = control.pilot_sample_size.empty() ? 0 : *std::max_element(control.pilot_sample_size.cbegin(), control.pilot_sample_size.cend());
+    int n_r = required_sampling_size(F.history, first_row, control.sample_size_tol, max_pilot + 2);
+    int sample_size = std::max(max_pilot + 2, n_r);
+    int n_r_old = -1;
+    while ((n_r_old < n_r) && !stopped(F)) {
+      ++F.metaiterations;
+      const size_t first = mcem_chain(theta, sample_size, control.meta_burnin, 3, F.metaiterations, n_r, F, A);
+      if (F.history.size() == first) break;
+      n_r_old = n_r;
+      n_r = required_sampling_size(F.history, first_row, control.sample_size_tol, sample_size);
+      theta = mean_pars(F.history, first, F.history.size());
+      sample_size = n_r;
+    }
+    F.estimates = theta;
+    F.required_sample_size = n_r;
+    auto T1 = std::chrono::high_resolution_clock::now();
+    F.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+    return F;
+  }
+
+}
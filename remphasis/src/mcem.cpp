@@ -43,13 +43,74 @@ namespace emphasis {
               const param_t& upper_bound, // overrides model.upper.bound
               double xtol,
               int num_threads,
-              conditional_fun_t* conditional)
+              conditional_fun_t* conditional,
+              tree_pool_t* pool,
+              double min_ess,
+              const sampler_control_t& sampler,
+              m_optimizer_t optimizer,
+              bool compact,
+              const deadline_t* deadline,
+              int minibatch,
+              const prune_control_t& prune)
   {
     auto EM = mcem_t();
-    EM.e = E_step(N, maxN, pars, brts, model, soc, max_missing, max_lambda, num_threads);
+    if (pool && !pool->logg.empty()) {
+      EM.e = recycle(pars, *pool, model, num_threads);
+      if (EM.e.ess < min_ess * static_cast<double>(pool->logg.size())) {
+        EM.e = E_step_t{};    // degenerated
+      }
+    }
+    auto fresh = tree_pool_t{};     // replaces *pool once the iteration completed
+    if (EM.e.recycled) {
+      EM.e.seed = sampler.seed;
+    }
+    else {
+      EM.e = E_step(N, maxN, pars, brts, model, soc, max_missing, max_lambda, num_threads, sampler, compact, deadline);
+      if (pool) {
+        // the pool takes over the trees
+        fresh.trees = std::move(EM.e.trees);
+        fresh.deltas = std::move(EM.e.deltas);
+        fresh.replay = std::move(EM.e.replay);
+        fresh.logg = EM.e.logg;
+        fresh.rejected = EM.e.rejected;
+        EM.e.pooled = &fresh;
+      }
+    }
+    emphasis::prune(EM.e, prune);
     // optimize
-    if (!EM.e.trees.empty()) {
-      EM.m = M_step(pars, EM.e.trees, EM.e.weights, model, lower_bound, upper_bound, xtol, num_threads, conditional);
+    auto m_step = [&](const auto& S) {
+      if (!S.replay.empty()) {
+        return M_step(pars, S.replay, EM.e.weights, model, lower_bound, upper_bound, xtol, num_threads, conditional, optimizer, deadline, minibatch, EM.e.seed);
+      }
+      if (!S.deltas.empty()) {
+        return M_step(pars, S.deltas, EM.e.weights, model, lower_bound, upper_bound, xtol, num_threads, conditional, optimizer, deadline, minibatch, EM.e.seed);
+      }
+      return M_step(pars, S.trees, EM.e.weights, model, lower_bound, upper_bound, xtol, num_threads, conditional, optimizer, deadline, minibatch, EM.e.seed);
+    };
+    if (EM.e.status != run_status_t::completed) {
+      EM.m.estimates = pars;
+      EM.m.status = EM.e.status;
+    }
+    else if (!EM.e.weights.empty()) {
+      EM.m = EM.e.pooled ? m_step(*EM.e.pooled) : m_step(EM.e);
+    }
+    if (pool) {
+      // the pool belongs to the last completed iteration
+      if (EM.m.status == run_status_t::completed) {
+        if (EM.e.recycled) {
+          ++pool->recycled;
+        }
+        else {
+          *pool = std::move(fresh);
+          if (EM.e.pooled) EM.e.pooled = pool;
+        }
+      }
+      else if (EM.e.pooled == &fresh) {
+        EM.e.trees = std::move(fresh.trees);
+        EM.e.deltas = std::move(fresh.deltas);
+        EM.e.replay = std::move(fresh.replay);
+        EM.e.pooled = nullptr;
+      }
     }
     return EM;
   }
@@ -0,0 +1,185 @@
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include "emphasis.hpp"
+#include "mds.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    // NaN compares as +inf
+    inline double fval(double f)
+    {
+      return std::isnan(f) ? std::numeric_limits<double>::infinity() : f;
+    }
+
+  }
+
+
+  mds::mds(size_t nparams)
+    : n_(nparams),
+    lower_(nparams, -std::numeric_limits<double>::max()),
+    upper_(nparams, +std::numeric_limits<double>::max())
+  {
+  }
+
+
+  void mds::set_xtol_rel(double val)
+  {
+    xtol_rel_ = val;
+  }
+
+
+  void mds::set_lower_bounds(const std::vector<double>& val)
+  {
+    if (val.size() != n_) throw emphasis_error("mds: invalid lower bounds");
+    lower_ = val;
+  }
+
+
+  void mds::set_upper_bounds(const std::vector<double>& val)
+  {
+    if (val.size() != n_) throw emphasis_error("mds: invalid upper bounds");
+    upper_ = val;
+  }
+
+
+  void mds::set_maxeval(int val)
+  {
+    maxeval_ = val;
+  }
+
+
+  void mds::set_initial_step(double val)
+  {
+    if (!(val > 0.0)) throw emphasis_error("mds: invalid initial step");
+    step_rel_ = val;
+  }
+
+
+  void mds::set_min_objective(batch_func f)
+  {
+    f_ = std::move(f);
+  }
+
+
+  void mds::set_stop(std::function<bool()> stop)
+  {
+    stop_ = std::move(stop);
+  }
+
+
+  void mds::project(double* x) const
+  {
+    for (size_t j = 0; j < n_; ++j) {
+      x[j] = std::min(upper_[j], std::max(lower_[j], x[j]));
+    }
+  }
+
+
+  // simplex S (row-major, n + 1 vertices, best first) within xtol_rel of its best vertex
+  bool mds::converged(const std::vector<double>& S) const
+  {
+    for (size_t i = 1; i <= n_; ++i) {
+      for (size_t j = 0; j < n_; ++j) {
+        const double x0 = S[j];
+        if (std::abs(S[i * n_ + j] - x0) > xtol_rel_ * std::max(std::abs(x0), 1e-8)) return false;
+      }
+    }
+    return true;
+  }
+
+
+  double mds::optimize(std::vector<double>& x)
+  {
+    if (!f_) throw emphasis_error("mds: no objective");
+    if (x.size() != n_) throw emphasis_error("mds: invalid x");
+    const size_t n = n_;
+    // initial simplex: coordinate steps, pointing into the feasible box
+    std::vector<double> S((n + 1) * n);
+    std::vector<double> fS(n + 1);
+    std::copy(x.cbegin(), x.cend(), S.begin());
+    project(S.data());
+    for (size_t i = 1; i <= n; ++i) {
+      double* v = S.data() + i * n;
+      std::copy_n(S.data(), n, v);
+      const size_t j = i - 1;
+      double step = (v[j] != 0.0) ? step_rel_ * std::abs(v[j]) : step_rel_;
+      if (v[j] + step > upper_[j]) step = -step;
+      v[j] += step;
+      project(v);
+    }
+    f_(n + 1, S.data(), fS.data());
+    int neval = static_cast<int>(n + 1);
+    // batch: reflection [0, n), expansion [n, 2n), contraction [2n, 3n)
+    std::vector<double> B(3 * n * n);
+    std::vector<double> fB(3 * n);
+    std::vector<size_t> order(n + 1);
+    auto sort_simplex = [&]() {
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fval(fS[a]) < fval(fS[b]); });
+      auto S0 = S;
+      auto fS0 = fS;
+      for (size_t i = 0; i <= n; ++i) {
+        std::copy_n(S0.data() + order[i] * n, n, S.data() + i * n);
+        fS[i] = fS0[order[i]];
+      }
+    };
+    sort_simplex();
+    result_ = NLOPT_XTOL_REACHED;
+    while (!converged(S)) {
+      if (maxeval_ > 0 && neval >= maxeval_) {
+        result_ = NLOPT_MAXEVAL_REACHED;
+        break;
+      }
+      if (stop_ && stop_()) {
+        result_ = NLOPT_FORCED_STOP;
+        break;
+      }
+      const double* v0 = S.data();
+      for (size_t i = 1; i <= n; ++i) {
+        const double* v = S.data() + i * n;
+        double* r = B.data() + (i - 1) * n;
+        double* e = B.data() + (n + i - 1) * n;
+        double* c = B.data() + (2 * n + i - 1) * n;
+        for (size_t j = 0; j < n; ++j) {
+          r[j] = 2.0 * v0[j] - v[j];
+          e[j] = 3.0 * v0[j] - 2.0 * v[j];
+          c[j] = 0.5 * (v0[j] + v[j]);
+        }
+        project(r); project(e); project(c);
+      }
+      f_(3 * n, B.data(), fB.data());
+      neval += static_cast<int>(3 * n);
+      auto fmin = [&](size_t first) {
+        return fval(*std::min_element(fB.cbegin() + first, fB.cbegin() + first + n, [](double a, double b) { return fval(a) < fval(b); }));
+      };
+      const double fr = fmin(0);
+      size_t accept = 2 * n;    // contraction
+      if (fr < fval(fS[0])) {
+        accept = (fmin(n) < fr) ? n : 0;
+      }
+      for (size_t i = 1; i <= n; ++i) {
+        size_t k = accept + i - 1;
+        if ((accept < 2 * n) && std::equal(v0, v0 + n, B.data() + k * n)) {
+          k = 2 * n + i - 1;    // projected onto the best vertex, keep the simplex proper
+        }
+        std::copy_n(B.data() + k * n, n, S.data() + i * n);
+        fS[i] = fB[k];
+      }
+      sort_simplex();
+    }
+    std::copy_n(S.data(), n, x.begin());
+    return fS[0];
+  }
+
+
+  nlopt_result mds::result()
+  {
+    return result_;
+  }
+
+}
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <tbb/tbb.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "proposal.hpp"
+#include "mds.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    tree_t thread_local scratch_tree;
+
+
+    // log of the second moment of the importance weights of the mixture
+    // (1 - defensive) g(q) + defensive g(pars), up to a constant, estimated
+    // from a weighted sample of the previous target.
+    template <typename TREES>
+    class second_moment
+    {
+    public:
+      second_moment(const param_t& pars, const TREES& trees, const E_step_t& E, const Model* model, double defensive)
+      : trees_(trees), model_(model), c_(E.weights.size()), g0_(E.weights.size()), 
+        log_d_(std::log(defensive)), log_1md_(std::log1p(-defensive))
+      {
+        // c = log w + 2 log f(pars) - log f_prev
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, c_.size()), [&](const tbb::blocked_range<size_t>& r) {
+          for (size_t i = r.begin(); i < r.end(); ++i) {
+            double logf = 0.0;
+            model->log_weight(pars, detail::tree_at(trees, i, scratch_tree), logf, g0_[i]);
+            c_[i] = std::log(E.weights[i]) + 2.0 * logf - E.logf[i];
+          }
+        });
+      }
+
+      double operator()(const param_t& q) const
+      {
+        std::vector<double> t(c_.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, c_.size()), [&](const tbb::blocked_range<size_t>& r) {
+          for (size_t i = r.begin(); i < r.end(); ++i) {
+            const double logg = log_1md_ + model_->sampling_prob(q, detail::tree_at(trees_, i, scratch_tree));
+            t[i] = c_[i] - detail::log_add_exp(logg, log_d_ + g0_[i]);
+          }
+        });
+        // log sum exp, deterministic order
+        const double m = *std::max_element(t.cbegin(), t.cend());
+        if (!std::isfinite(m)) return std::numeric_limits<double>::max();
+        double s = 0.0;
+        for (const double x : t) s += std::exp(x - m);
+        return m + std::log(s);
+      }
+
+    private:
+      const TREES& trees_;
+      const Model* model_;
+      std::vector<double> c_;
+      std::vector<double> g0_;          // log g(pars)
+      double log_d_, log_1md_;
+    };
+
+
+    template <typename TREES>
+    proposal_t do_adapt_proposal(const param_t& pars, const TREES& trees, const E_step_t& E, Model* model, double defensive, const param_t& lower, const param_t& upper, int max_evals)
+    {
+      const second_moment<TREES> M2(pars, trees, E, model, defensive);
+      const size_t n = pars.size();
+      mds opt(n);
+      opt.set_xtol_rel(0.01);
+      opt.set_maxeval(max_evals);
+      if (!lower.empty()) opt.set_lower_bounds(lower);
+      if (!upper.empty()) opt.set_upper_bounds(upper);
+      opt.set_min_objective([&](size_t m, const double* x, double* f) {
+        for (size_t j = 0; j < m; ++j) {
+          f[j] = M2(param_t(x + j * n, x + (j + 1) * n));
+        }
+      });
+      auto q = pars;
+      const double f0 = M2(q);
+      const double f = opt.optimize(q);
+      auto proposal = proposal_t{};
+      proposal.defensive = defensive;
+      if (f < f0) {
+        proposal.pars.push_back(q);
+      }
+      else {
+        proposal.pars.push_back(pars);   // no improvement over the target
+      }
+      return proposal;
+    }
+
+  }
+
+
+  proposal_t adapt_proposal(const param_t& pars,
+                            const E_step_t& E,
+                            Model* model,
+                            double defensive,
+                            const param_t& lower_bound,
+                            const param_t& upper_bound,
+                            int num_threads,
+                            int max_evals)
+  {
+    if (E.weights.empty()) throw emphasis_error("adapt_proposal: empty sample");
+    if (E.logf.size() != E.weights.size()) throw emphasis_error("adapt_proposal: sample without log-likelihoods");
+    if (!(defensive > 0.0) || !(defensive < 1.0)) throw emphasis_error("adapt_proposal: defensive weight must be in (0, 1)");
+    if (!model->is_threadsafe()) num_threads = 1;
+    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+    const auto lower = lower_bound.empty() ? model->lower_bound() : lower_bound;
+    const auto upper = upper_bound.empty() ? model->upper_bound() : upper_bound;
+    auto adapt = [&](const auto& S) {
+      if (!S.replay.empty()) {
+        return do_adapt_proposal(pars, S.replay, E, model, defensive, lower, upper, max_evals);
+      }
+      if (!S.deltas.empty()) {
+        return do_adapt_proposal(pars, S.deltas, E, model, defensive, lower, upper, max_evals);
+      }
+      return do_adapt_proposal(pars, S.trees, E, model, defensive, lower, upper, max_evals);
+    };
+    return E.pooled ? adapt(*E.pooled) : adapt(E);
+  }
+
+}
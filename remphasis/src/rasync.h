@@ -0,0 +1,45 @@
+#ifndef EMPHASIS_RASYNC_H_INCLUDED
+#define EMPHASIS_RASYNC_H_INCLUDED
+
+#include <memory>
+#include <Rcpp.h>
+#include "async.hpp"
+
+
+// asynchronous run started from R. The job runs on a thread of its own and
+// must not call R; collect converts its result on the R thread.
+struct r_async_t
+{
+  Rcpp::List keep;                              // R objects the job refers to
+  std::function<Rcpp::List()> collect;
+  std::unique_ptr<emphasis::async_run_t> run;   // last, cancelled and joined first
+};
+
+
+// starts job and returns the handle. Must be called on the R thread.
+template <typename RESULT>
+inline SEXP make_r_async(std::function<RESULT(const emphasis::deadline_t&, emphasis::async_run_t&)> job,
+                         std::function<Rcpp::List(RESULT&)> collect,
+                         double max_time,
+                         Rcpp::List keep = Rcpp::List())
+{
+  auto result = std::make_shared<RESULT>();
+  auto h = new r_async_t;
+  h->keep = keep;
+  h->collect = [result, collect]() { return collect(*result); };
+  h->run.reset(new emphasis::async_run_t([result, job](const emphasis::deadline_t& deadline, emphasis::async_run_t& run) {
+    *result = job(deadline, run);
+  }, max_time));
+  return Rcpp::XPtr<r_async_t>(h, true);
+}
+
+
+// R functions can't be evaluated off the R thread
+inline void check_async_conditional(SEXP rconditional)
+{
+  if (Rf_isFunction(rconditional)) {
+    throw std::runtime_error("asynchronous runs require a conditional from make_conditional_grid or make_survival_conditional");
+  }
+}
+
+#endif
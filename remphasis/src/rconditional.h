@@ -0,0 +1,49 @@
+#ifndef EMPHASIS_RCONDITIONAL_H_INCLUDED
+#define EMPHASIS_RCONDITIONAL_H_INCLUDED
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "conditional_grid.hpp"
+#include "survival.hpp"
+#include "rplugin.h"
+
+
+// conditional probability from R: NULL, a function, a grid
+// from make_conditional_grid or a survival_conditional.
+// Functions are evaluated on the main thread only.
+inline emphasis::conditional_fun_t make_conditional(SEXP rconditional)
+{
+  using namespace Rcpp;
+  if (Rf_isNull(rconditional)) {
+    return {};
+  }
+  if (Rf_isFunction(rconditional)) {
+    return [cond = Function(rconditional)](const emphasis::param_t& pars) {
+      return as<double>( cond(NumericVector(pars.cbegin(), pars.cend())) );
+    };
+  }
+  if (Rf_inherits(rconditional, "survival_conditional")) {
+    List sc(rconditional);
+    std::shared_ptr<emphasis::Model> model = make_plugin_model(as<std::string>(sc["plugin"]));
+    auto control = emphasis::survival_control_t{};
+    control.simulations = as<int>(sc["simulations"]);
+    control.max_lineages = as<int>(sc["max_lineages"]);
+    control.seed = static_cast<uint64_t>(as<double>(sc["seed"]));
+    auto fun = emphasis::survival_conditional(as<double>(sc["age"]), model.get(), as<int>(sc["soc"]), control, as<int>(sc["num_threads"]));
+    return [model, fun = std::move(fun)](const emphasis::param_t& pars) {
+      return fun(pars);
+    };
+  }
+  List grid(rconditional);
+  List raxes = grid["axes"];
+  std::vector<std::vector<double>> axes;
+  for (R_xlen_t j = 0; j < raxes.size(); ++j) {
+    axes.push_back(as<std::vector<double>>(raxes[j]));
+  }
+  auto cg = emphasis::conditional_grid(std::move(axes), as<std::vector<double>>(grid["values"]));
+  return [cg = std::move(cg)](const emphasis::param_t& pars) {
+    return cg(pars);
+  };
+}
+
+#endif
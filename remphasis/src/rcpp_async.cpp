@@ -0,0 +1,86 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <algorithm>
+#include <chrono>
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "rasync.h"
+#include "rdeadline.h"
+using namespace Rcpp;
+
+
+namespace {
+
+  constexpr double wait_slice = 0.1;    // [s] between checks for user interrupts
+
+
+  r_async_t* as_async(SEXP handle)
+  {
+    auto h = XPtr<r_async_t>(handle).get();
+    if ((h == nullptr) || !h->run) {
+      throw std::runtime_error("invalid async handle");
+    }
+    return h;
+  }
+
+}
+
+
+// [[Rcpp::export(name = "async_progress_cpp")]]
+List rcpp_async_progress(SEXP handle)
+{
+  const auto& run = *as_async(handle)->run;
+  const auto p = run.progress();
+  return List::create(Named("done") = run.done(),
+                      Named("status") = emphasis::status_string(run.status()),
+                      Named("time") = run.elapsed(),
+                      Named("phase") = p.phase,
+                      Named("metaiteration") = p.metaiteration,
+                      Named("iteration") = p.iteration,
+                      Named("sample_size") = p.sample_size,
+                      Named("required_sample_size") = p.required_sample_size,
+                      Named("fhat") = p.fhat,
+                      Named("sde") = p.sde,
+                      Named("estimates") = NumericVector(p.estimates.cbegin(), p.estimates.cend()));
+}
+
+
+// waits at most timeout [s] for the run to finish. A user interrupt
+// cancels the run. Returns true if the run has finished.
+// [[Rcpp::export(name = "async_wait_cpp")]]
+bool rcpp_async_wait(SEXP handle, double timeout)
+{
+  auto& run = *as_async(handle)->run;
+  const auto T0 = std::chrono::steady_clock::now();
+  for (;;) {
+    const double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - T0).count();
+    const double slice = std::min(wait_slice, timeout - waited);
+    if (slice <= 0.0) return run.done();
+    if (run.wait(slice)) return true;
+    if (r_interrupt_pending()) {
+      run.cancel();
+      run.wait(-1.0);
+      return true;
+    }
+  }
+}
+
+
+// [[Rcpp::export(name = "async_cancel_cpp")]]
+void rcpp_async_cancel(SEXP handle)
+{
+  as_async(handle)->run->cancel();
+}
+
+
+// results of the finished run, rethrows errors from the run
+// [[Rcpp::export(name = "async_result_cpp")]]
+List rcpp_async_result(SEXP handle)
+{
+  auto h = as_async(handle);
+  if (!h->run->done()) {
+    throw std::runtime_error("async run not finished");
+  }
+  h->run->rethrow();
+  return h->collect();
+}
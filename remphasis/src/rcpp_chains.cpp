@@ -0,0 +1,98 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "rinit.h"
+#include "rplugin.h"
+#include "rconditional.h"
+#include "rdeadline.h"
+using namespace Rcpp;
+
+
+// [[Rcpp::export(name = "em_chains_cpp")]]
+List rcpp_mcem_chains(const std::vector<double>& brts,
+                      const std::vector<double>& init_pars,
+                      int sample_size,
+                      int maxN,
+                      const std::string& plugin,
+                      int soc,
+                      int max_missing,
+                      double max_lambda,
+                      const std::vector<double>& lower_bound,
+                      const std::vector<double>& upper_bound,
+                      double xtol_rel,
+                      int num_threads,
+                      int chains,
+                      double dispersion,
+                      int burnin,
+                      int check_interval,
+                      int max_iterations,
+                      double max_rhat,
+                      SEXP rconditional = R_NilValue,
+                      const std::string& sampler = "iid",
+                      int replicates = 8,
+                      const std::string& optimizer = "sbplx",
+                      bool compact = false,
+                      double max_time = 0,
+                      double seed = 0)
+{
+  // chains evaluate the conditional concurrently, off the R thread
+  if (Rf_isFunction(rconditional)) {
+    throw std::runtime_error("concurrent chains require a conditional from make_conditional_grid or make_survival_conditional");
+  }
+  auto model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  auto deadline = make_deadline(max_time);
+  auto control = emphasis::chains_control_t{};
+  control.chains = chains;
+  control.dispersion = dispersion;
+  control.burnin = burnin;
+  control.check_interval = check_interval;
+  control.max_iterations = max_iterations;
+  control.max_rhat = max_rhat;
+  control.sampler.type = emphasis::make_sampler_type(sampler);
+  control.sampler.replicates = replicates;
+  control.sampler.seed = static_cast<uint64_t>(seed);
+  control.optimizer = emphasis::make_m_optimizer(optimizer);
+  control.compact = compact;
+  auto C = emphasis::mcem_chains(sample_size,
+                                 maxN,
+                                 init_pars,
+                                 brts,
+                                 model.get(),
+                                 soc,
+                                 max_missing,
+                                 max_lambda,
+                                 lower_bound,
+                                 upper_bound,
+                                 xtol_rel,
+                                 num_threads,
+                                 conditional ? &conditional : nullptr,
+                                 control,
+                                 deadline.get());
+  List trace;
+  for (const auto& H : C.history) {
+    NumericMatrix pars(static_cast<int>(H.size()), H.nparams);
+    for (int i = 0; i < pars.nrow(); ++i) {
+      for (int j = 0; j < pars.ncol(); ++j) {
+        pars(i, j) = H.row(i)[j];
+      }
+    }
+    trace.push_back(List::create(Named("pars") = pars, Named("fhat") = H.fhat));
+  }
+  List ret;
+  ret["estimates"] = NumericVector(C.estimates.begin(), C.estimates.end());
+  ret["se"] = NumericVector(C.se.begin(), C.se.end());
+  ret["rhat"] = NumericVector(C.rhat.begin(), C.rhat.end());
+  ret["fhat"] = C.fhat;
+  ret["fhat_se"] = C.fhat_se;
+  ret["fhat_rhat"] = C.fhat_rhat;
+  ret["chains"] = trace;
+  ret["iterations"] = C.iterations;
+  ret["converged"] = C.converged;
+  ret["seed"] = static_cast<double>(C.seed);
+  ret["status"] = emphasis::status_string(C.status);
+  ret["time"] = C.elapsed;
+  return ret;
+}
@@ -0,0 +1,265 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "rinit.h"
+#include "rplugin.h"
+#include "rconditional.h"
+#include "rdeadline.h"
+#include "rasync.h"
+using namespace Rcpp;
+
+
+namespace {
+
+  emphasis::fit_control_t make_fit_control(int burnin_sample_size,
+                                           const std::vector<int>& pilot_sample_size,
+                                           int burnin_iterations,
+                                           double em_tol,
+                                           double sample_size_tol,
+                                           double recycle_ess,
+                                           int max_iterations,
+                                           const std::string& sampler,
+                                           int replicates,
+                                           const std::string& optimizer,
+                                           bool compact,
+                                           int minibatch,
+                                           const std::string& prune,
+                                           double prune_threshold,
+                                           const std::string& checkpoint,
+                                           int checkpoint_interval,
+                                           bool resume,
+                                           bool adapt_proposal,
+                                           double defensive,
+                                           bool replay,
+                                           int replay_cache,
+                                           double seed)
+  {
+    auto control = emphasis::fit_control_t{};
+    control.burnin_sample_size = burnin_sample_size;
+    control.pilot_sample_size = pilot_sample_size;
+    control.burnin_iterations = burnin_iterations;
+    control.em_tol = em_tol;
+    control.sample_size_tol = sample_size_tol;
+    control.recycle_ess = recycle_ess;
+    control.max_iterations = max_iterations;
+    control.sampler.type = emphasis::make_sampler_type(sampler);
+    control.sampler.replicates = replicates;
+    control.optimizer = emphasis::make_m_optimizer(optimizer);
+    control.compact = compact;
+    control.minibatch = minibatch;
+    control.prune.type = emphasis::make_prune_type(prune);
+    control.prune.threshold = prune_threshold;
+    control.checkpoint = checkpoint;
+    control.checkpoint_interval = checkpoint_interval;
+    control.resume = resume;
+    control.adapt_proposal = adapt_proposal;
+    control.sampler.proposal.defensive = defensive;
+    control.sampler.replay = replay;
+    control.sampler.replay_cache = replay_cache;
+    control.sampler.seed = static_cast<uint64_t>(seed);
+    return control;
+  }
+
+
+  List wrap_fit(const emphasis::fit_t& F)
+  {
+    const auto& H = F.history;
+    NumericMatrix pars(static_cast<int>(H.size()), H.nparams);
+    for (int i = 0; i < pars.nrow(); ++i) {
+      for (int j = 0; j < pars.ncol(); ++j) {
+        pars(i, j) = H.row(i)[j];
+      }
+    }
+    List ret;
+    ret["estimates"] = NumericVector(F.estimates.begin(), F.estimates.end());
+    ret["pars"] = pars;
+    ret["fhat"] = H.fhat;
+    ret["sample_size"] = H.sample_size;
+    ret["phase"] = H.phase;
+    ret["metaiterations"] = F.metaiterations;
+    ret["required_sample_size"] = F.required_sample_size;
+    ret["truncated"] = F.truncated;
+    ret["status"] = emphasis::status_string(F.status);
+    ret["resumed"] = F.resumed;
+    ret["seed"] = static_cast<double>(F.seed);
+    ret["time"] = F.elapsed;
+    return ret;
+  }
+
+}
+
+
+// [[Rcpp::export(name = "fit_cpp")]]
+List rcpp_fit(const std::vector<double>& brts,       
+              const std::vector<double>& init_pars,      
+              const std::string& plugin,             
+              int soc,
+              int max_missing,               
+              double max_lambda,             
+              const std::vector<double>& lower_bound,  
+              const std::vector<double>& upper_bound,  
+              double xtol_rel,                     
+              int num_threads,
+              int burnin_sample_size,
+              const std::vector<int>& pilot_sample_size,
+              int burnin_iterations,
+              double em_tol,
+              double sample_size_tol,
+              double recycle_ess,
+              int max_iterations,
+              SEXP rconditional = R_NilValue,
+              Nullable<Function> rprogress = R_NilValue,
+              const std::string& sampler = "iid",
+              int replicates = 8,
+              const std::string& optimizer = "sbplx",
+              bool compact = false,
+              double max_time = 0,
+              int minibatch = 0,
+              const std::string& prune = "none",
+              double prune_threshold = 1e-6,
+              const std::string& checkpoint = "",
+              int checkpoint_interval = 1,
+              bool resume = false,
+              bool adapt_proposal = false,
+              double defensive = 0.1,
+              bool replay = false,
+              int replay_cache = 0,
+              double seed = 0)
+{
+  auto model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  emphasis::fit_callback_t callback{};
+  if (rprogress.isNotNull()) {
+    callback = [progress = Function(rprogress)](const emphasis::fit_progress_t& p) {
+      progress(List::create(Named("phase") = p.phase,
+                            Named("metaiteration") = p.metaiteration,
+                            Named("iteration") = p.iteration,
+                            Named("sample_size") = p.sample_size,
+                            Named("required_sample_size") = p.required_sample_size,
+                            Named("fhat") = p.fhat,
+                            Named("sde") = p.sde,
+                            Named("estimates") = NumericVector(p.estimates.cbegin(), p.estimates.cend())));
+    };
+  }
+  auto control = make_fit_control(burnin_sample_size,
+                                  pilot_sample_size,
+                                  burnin_iterations,
+                                  em_tol,
+                                  sample_size_tol,
+                                  recycle_ess,
+                                  max_iterations,
+                                  sampler,
+                                  replicates,
+                                  optimizer,
+                                  compact,
+                                  minibatch,
+                                  prune,
+                                  prune_threshold,
+                                  checkpoint,
+                                  checkpoint_interval,
+                                  resume,
+                                  adapt_proposal,
+                                  defensive,
+                                  replay,
+                                  replay_cache,
+                                  seed);
+  auto deadline = make_deadline(max_time);
+  auto F = emphasis::fit(init_pars,
+                         brts,
+                         model.get(),
+                         soc,
+                         max_missing,
+                         max_lambda,
+                         lower_bound,
+                         upper_bound,
+                         xtol_rel,
+                         num_threads,
+                         conditional ? &conditional : nullptr,
+                         control,
+                         callback,
+                         deadline.get());
+  return wrap_fit(F);
+}
+
+
+// fit_cpp on a thread of its own, returns the handle for the async_*_cpp functions
+// [[Rcpp::export(name = "fit_async_cpp")]]
+SEXP rcpp_fit_async(const std::vector<double>& brts,
+                    const std::vector<double>& init_pars,
+                    const std::string& plugin,
+                    int soc,
+                    int max_missing,
+                    double max_lambda,
+                    const std::vector<double>& lower_bound,
+                    const std::vector<double>& upper_bound,
+                    double xtol_rel,
+                    int num_threads,
+                    int burnin_sample_size,
+                    const std::vector<int>& pilot_sample_size,
+                    int burnin_iterations,
+                    double em_tol,
+                    double sample_size_tol,
+                    double recycle_ess,
+                    int max_iterations,
+                    SEXP rconditional = R_NilValue,
+                    const std::string& sampler = "iid",
+                    int replicates = 8,
+                    const std::string& optimizer = "sbplx",
+                    bool compact = false,
+                    double max_time = 0,
+                    int minibatch = 0,
+                    const std::string& prune = "none",
+                    double prune_threshold = 1e-6,
+                    const std::string& checkpoint = "",
+                    int checkpoint_interval = 1,
+                    bool resume = false,
+                    bool adapt_proposal = false,
+                    double defensive = 0.1,
+                    bool replay = false,
+                    int replay_cache = 0,
+                    double seed = 0)
+{
+  check_async_conditional(rconditional);
+  std::shared_ptr<emphasis::Model> model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  auto control = make_fit_control(burnin_sample_size,
+                                  pilot_sample_size,
+                                  burnin_iterations,
+                                  em_tol,
+                                  sample_size_tol,
+                                  recycle_ess,
+                                  max_iterations,
+                                  sampler,
+                                  replicates,
+                                  optimizer,
+                                  compact,
+                                  minibatch,
+                                  prune,
+                                  prune_threshold,
+                                  checkpoint,
+                                  checkpoint_interval,
+                                  resume,
+                                  adapt_proposal,
+                                  defensive,
+                                  replay,
+                                  replay_cache,
+                                  seed);
+  return make_r_async<emphasis::fit_t>([=](const emphasis::deadline_t& deadline, emphasis::async_run_t& run) mutable {
+    return emphasis::fit(init_pars,
+                         brts,
+                         model.get(),
+                         soc,
+                         max_missing,
+                         max_lambda,
+                         lower_bound,
+                         upper_bound,
+                         xtol_rel,
+                         num_threads,
+                         conditional ? &conditional : nullptr,
+                         control,
+                         [&run](const emphasis::fit_progress_t& p) { run.report(p); },
+                         &deadline);
+  }, wrap_fit, max_time);
+}
@@ -0,0 +1,385 @@
+// [[Rcpp::plugins(cpp14)]]
+
+// probes of the numerical helpers for the tests, not exported
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "state_guard.hpp"
+#include "model_helpers.hpp"
+#include "envelope_cache.hpp"
+#include "maximize_1d.hpp"
+#include "gelman_rubin.hpp"
+#include "sbplx.hpp"
+#include "mds.hpp"
+#include "rplugin.h"
+#include "rproposal.h"
+using namespace Rcpp;
+
+
+namespace {
+
+  emphasis::tree_t pack(const DataFrame& df)
+  {
+    emphasis::tree_t tree;
+    auto brts = as<NumericVector>(df["brts"]);
+    auto n = as<NumericVector>(df["n"]);
+    auto t_ext = as<NumericVector>(df["t_ext"]);
+    for (auto i = 0; i < brts.size(); ++i) {
+      tree.push_back(emphasis::node_t{brts[i], n[i], t_ext[i], 0.0});
+    }
+    return tree;
+  }
+
+
+  DataFrame unpack_pd(const emphasis::tree_t& tree)
+  {
+    NumericVector brts, n, t_ext, pd;
+    for (const emphasis::node_t& node : tree) {
+      brts.push_back(node.brts);
+      n.push_back(node.n);
+      t_ext.push_back(node.t_ext);
+      pd.push_back(node.pd);
+    }
+    return DataFrame::create(Named("brts") = brts, Named("n") = n, Named("t_ext") = t_ext, Named("pd") = pd);
+  }
+
+
+  // forwards to model but scores by separate loglik and sampling_prob calls
+  class unfused_model : public emphasis::Model
+  {
+  public:
+    explicit unfused_model(const emphasis::Model* model) : model_(model) {}
+
+    const char* description() const override { return model_->description(); }
+    bool is_threadsafe() const override { return model_->is_threadsafe(); }
+    bool numerical_max_lambda() const override { return model_->numerical_max_lambda(); }
+    int nparams() const override { return model_->nparams(); }
+
+    double extinction_time(double t_speciation, const emphasis::param_t& pars, const emphasis::tree_t& tree) const override {
+      return model_->extinction_time(t_speciation, pars, tree);
+    }
+
+    double nh_rate(double t, const emphasis::param_t& pars, const emphasis::tree_t& tree) const override {
+      return model_->nh_rate(t, pars, tree);
+    }
+
+    double sampling_prob(const emphasis::param_t& pars, const emphasis::tree_t& tree) const override {
+      return model_->sampling_prob(pars, tree);
+    }
+
+    double loglik(const emphasis::param_t& pars, const emphasis::tree_t& tree) const override {
+      return model_->loglik(pars, tree);
+    }
+
+    bool bd_rates(double t, const emphasis::param_t& pars, double n, double pd, double* rates) const override {
+      return model_->bd_rates(t, pars, n, pd, rates);
+    }
+
+    double nh_rate_state(void** state, double t, const emphasis::param_t& pars, const emphasis::tree_t& tree) const override {
+      return model_->nh_rate_state(state, t, pars, tree);
+    }
+
+    void advance_state(void** state, double t, const emphasis::tree_t& tree) const override { model_->advance_state(state, t, tree); }
+    void invalidate_state(void** state, double t0, double t1) const override { model_->invalidate_state(state, t0, t1); }
+    void free_state(void** state) const override { model_->free_state(state); }
+    emphasis::param_t lower_bound() const override { return model_->lower_bound(); }
+    emphasis::param_t upper_bound() const override { return model_->upper_bound(); }
+
+  private:
+    const emphasis::Model* model_;
+  };
+
+
+  double r_objective(unsigned n, const double* x, double*, void* f)
+  {
+    return as<double>((*static_cast<Function*>(f))(NumericVector(x, x + n)));
+  }
+
+}
+
+
+// n truncated exponential variates from a seeded stream
+// [[Rcpp::export(name = ".trunc_exp_cpp")]]
+NumericVector rcpp_trunc_exp(int n, double upper, double rate, double seed)
+{
+  auto reng = emphasis::detail::reng_t(static_cast<uint64_t>(seed));
+  NumericVector x(n);
+  for (auto& xi : x) {
+    xi = emphasis::detail::trunc_exp(upper, rate, reng);
+  }
+  return x;
+}
+
+
+// nh_rate and nh_rate_state of the plugin at the times t, in that order.
+// The state is advanced to every t before it is evaluated, as in the sampler.
+// [[Rcpp::export(name = ".nh_rate_cpp")]]
+List rcpp_nh_rate(const std::string& plugin,
+                  const std::vector<double>& pars,
+                  DataFrame tree,
+                  const std::vector<double>& t)
+{
+  auto model = make_plugin_model(plugin);
+  const auto T = pack(tree);
+  emphasis::state_guard state(model.get());
+  NumericVector rate, rate_state;
+  for (const double ti : t) {
+    rate.push_back(model->nh_rate(ti, pars, T));
+    state.advance(ti, T);
+    rate_state.push_back(model->nh_rate_state(state, ti, pars, T));
+  }
+  return List::create(Named("rate") = rate, Named("rate_state") = rate_state);
+}
+
+
+// trees of a seeded E-step stored in full and expanded from its compact twin
+// [[Rcpp::export(name = ".delta_expand_cpp")]]
+List rcpp_delta_expand(const std::vector<double>& brts,
+                       const std::vector<double>& init_pars,
+                       int sample_size,
+                       int maxN,
+                       const std::string& plugin,
+                       int soc,
+                       int max_missing,
+                       double max_lambda,
+                       int num_threads,
+                       double seed)
+{
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.seed = static_cast<uint64_t>(seed);
+  auto E = [&](bool compact) {
+    return emphasis::E_step(sample_size, maxN, init_pars, brts, model.get(), soc, max_missing, max_lambda, num_threads, control, compact);
+  };
+  const auto full = E(false);
+  const auto compact = E(true);
+  List rfull, rexpanded;
+  for (const auto& tree : full.trees) {
+    rfull.push_back(unpack_pd(tree));
+  }
+  emphasis::tree_t tree;
+  for (size_t i = 0; i < compact.deltas.size(); ++i) {
+    compact.deltas.expand(i, tree);
+    rexpanded.push_back(unpack_pd(tree));
+  }
+  return List::create(Named("full") = rfull, Named("expanded") = rexpanded);
+}
+
+
+// trees of a seeded E-step stored in full and regenerated from its seed-replay
+// twin, twice so that the second pass reads the first replay_cache trees
+// from the cache
+// [[Rcpp::export(name = ".replay_expand_cpp")]]
+List rcpp_replay_expand(const std::vector<double>& brts,
+                        const std::vector<double>& init_pars,
+                        int sample_size,
+                        int maxN,
+                        const std::string& plugin,
+                        int soc,
+                        int max_missing,
+                        double max_lambda,
+                        int num_threads,
+                        double seed,
+                        int replay_cache)
+{
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.seed = static_cast<uint64_t>(seed);
+  const auto full = emphasis::E_step(sample_size, maxN, init_pars, brts, model.get(), soc, max_missing, max_lambda, num_threads, control);
+  control.replay = true;
+  control.replay_cache = replay_cache;
+  const auto replay = emphasis::E_step(sample_size, maxN, init_pars, brts, model.get(), soc, max_missing, max_lambda, num_threads, control);
+  List rfull, rfirst, rsecond;
+  for (const auto& tree : full.trees) {
+    rfull.push_back(unpack_pd(tree));
+  }
+  emphasis::tree_t tree;
+  for (size_t i = 0; i < replay.replay.size(); ++i) {
+    replay.replay.expand(i, tree);
+    rfirst.push_back(unpack_pd(tree));
+  }
+  for (size_t i = 0; i < replay.replay.size(); ++i) {
+    replay.replay.expand(i, tree);
+    rsecond.push_back(unpack_pd(tree));
+  }
+  return List::create(Named("full") = rfull, Named("first") = rfirst, Named("second") = rsecond,
+                      Named("weights") = full.weights, Named("replay_weights") = replay.weights);
+}
+
+
+// seeded E-step on per-thread private copies of the plugin
+// [[Rcpp::export(name = ".isolated_e_cpp")]]
+List rcpp_isolated_e(const std::vector<double>& brts,
+                     const std::vector<double>& init_pars,
+                     int sample_size,
+                     int maxN,
+                     const std::string& plugin,
+                     int soc,
+                     int max_missing,
+                     double max_lambda,
+                     int num_threads,
+                     double seed)
+{
+  auto model = emphasis::detail::create_isolated_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.seed = static_cast<uint64_t>(seed);
+  const auto E = emphasis::E_step(sample_size, maxN, init_pars, brts, model.get(), soc, max_missing, max_lambda, num_threads, control);
+  List trees;
+  for (const auto& tree : E.trees) {
+    trees.push_back(unpack_pd(tree));
+  }
+  return List::create(Named("trees") = trees, Named("weights") = E.weights, Named("fhat") = E.fhat, Named("rejected") = E.rejected);
+}
+
+
+// seeded E-step scored by the fused log_weight of the plugin and by
+// separate loglik and sampling_prob calls
+// [[Rcpp::export(name = ".fused_weights_cpp")]]
+List rcpp_fused_weights(const std::vector<double>& brts,
+                        const std::vector<double>& init_pars,
+                        int sample_size,
+                        int maxN,
+                        const std::string& plugin,
+                        int soc,
+                        int max_missing,
+                        double max_lambda,
+                        int num_threads,
+                        double seed)
+{
+  auto model = make_plugin_model(plugin);
+  unfused_model unfused(model.get());
+  auto control = emphasis::sampler_control_t{};
+  control.seed = static_cast<uint64_t>(seed);
+  auto E = [&](emphasis::Model* m) {
+    const auto e = emphasis::E_step(sample_size, maxN, init_pars, brts, m, soc, max_missing, max_lambda, num_threads, control);
+    return List::create(Named("weights") = e.weights, Named("logf") = e.logf, Named("logg") = e.logg, Named("fhat") = e.fhat);
+  };
+  return List::create(Named("fused") = E(model.get()), Named("unfused") = E(&unfused));
+}
+
+
+// seeded E-step under a mixture proposal. Besides the weights, logf and logg
+// of the sampler, returns loglik and the sampling_prob of every tree under the
+// target (column 1) and under each component of the proposal.
+// [[Rcpp::export(name = ".mixture_weights_cpp")]]
+List rcpp_mixture_weights(const std::vector<double>& brts,
+                          const std::vector<double>& init_pars,
+                          int sample_size,
+                          int maxN,
+                          const std::string& plugin,
+                          int soc,
+                          int max_missing,
+                          double max_lambda,
+                          int num_threads,
+                          double seed,
+                          SEXP proposal)
+{
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.seed = static_cast<uint64_t>(seed);
+  control.proposal = make_proposal(proposal);
+  const auto E = emphasis::E_step(sample_size, maxN, init_pars, brts, model.get(), soc, max_missing, max_lambda, num_threads, control);
+  auto components = control.proposal.pars;
+  components.insert(components.begin(), init_pars);
+  NumericVector loglik(E.trees.size());
+  NumericMatrix sampling_prob(static_cast<int>(E.trees.size()), static_cast<int>(components.size()));
+  for (size_t i = 0; i < E.trees.size(); ++i) {
+    loglik[i] = model->loglik(init_pars, E.trees[i]);
+    for (size_t k = 0; k < components.size(); ++k) {
+      sampling_prob(i, k) = model->sampling_prob(components[k], E.trees[i]);
+    }
+  }
+  return List::create(Named("weights") = E.weights,
+                      Named("logf") = E.logf,
+                      Named("logg") = E.logg,
+                      Named("loglik") = loglik,
+                      Named("sampling_prob") = sampling_prob);
+}
+
+
+// thinning with envelope_cache as in do_augment_tree, for the rate
+// rate0 * exp(-decay * t) on [0, age]. Every accepted event invalidates the
+// envelope as an inserted species would.
+// [[Rcpp::export(name = ".envelope_thinning_cpp")]]
+List rcpp_envelope_thinning(double rate0, double decay, double age, int runs, double seed)
+{
+  auto reng = emphasis::detail::reng_t(static_cast<uint64_t>(seed));
+  auto rate = [=](double t) { return rate0 * std::exp(-decay * t); };
+  int bounds = 0, proposals = 0;
+  double min_slack = emphasis::detail::huge;
+  auto maximize = [&](double t0, double t1) { ++bounds; return std::max(rate(t0), rate(t1)); };
+  IntegerVector events(runs);
+  for (auto& k : events) {
+    emphasis::detail::envelope_cache envelope;
+    double cbt = 0.0;
+    while (cbt < age) {
+      const auto& piece = envelope.at(cbt, age, maximize);
+      const double lambda_max = piece.bound;
+      const double piece_end = piece.t1;
+      const double t = cbt - std::log(emphasis::detail::uniform(reng)) / lambda_max;
+      if (t < piece_end) {
+        ++proposals;
+        min_slack = std::min(min_slack, lambda_max - rate(t));
+        const double pt = rate(t) / lambda_max;
+        if (emphasis::detail::uniform(reng) < pt) {
+          ++k;
+          envelope.invalidate(t);
+        }
+        else {
+          envelope.reject(pt);
+        }
+      }
+      cbt = std::min(t, piece_end);
+    }
+  }
+  return List::create(Named("events") = events,
+                      Named("bounds") = bounds,
+                      Named("proposals") = proposals,
+                      Named("min_slack") = min_slack);
+}
+
+
+// detail::maximize_1d of the R function f on [a, b]
+// [[Rcpp::export(name = ".maximize_1d_cpp")]]
+double rcpp_maximize_1d(Function f, double a, double b, int max_evals, double xtol_rel)
+{
+  auto fun = [&f](double x) { return as<double>(f(x)); };
+  return emphasis::detail::maximize_1d(fun, a, b, max_evals, xtol_rel);
+}
+
+
+// minimum of the R function f from x0 found by sbplx and by mds
+// [[Rcpp::export(name = ".minimize_cpp")]]
+List rcpp_minimize(Function f, const std::vector<double>& x0, double xtol_rel)
+{
+  const size_t n = x0.size();
+  auto xs = x0;
+  emphasis::sbplx sbplx(n);
+  sbplx.set_xtol_rel(xtol_rel);
+  sbplx.set_min_objective(r_objective, &f);
+  sbplx.optimize(xs);
+  auto xm = x0;
+  emphasis::mds mds(n);
+  mds.set_xtol_rel(xtol_rel);
+  mds.set_min_objective([&](size_t m, const double* x, double* fx) {
+    for (size_t i = 0; i < m; ++i) {
+      fx[i] = r_objective(static_cast<unsigned>(n), x + i * n, nullptr, &f);
+    }
+  });
+  mds.optimize(xm);
+  return List::create(Named("sbplx") = xs, Named("mds") = xm);
+}
+
+
+// detail::gelman_rubin of the chains, numeric vectors of equal length
+// [[Rcpp::export(name = ".gelman_rubin_cpp")]]
+List rcpp_gelman_rubin(List chains)
+{
+  std::vector<std::vector<double>> H;
+  for (auto it = chains.cbegin(); it != chains.cend(); ++it) {
+    H.push_back(as<std::vector<double>>(*it));
+  }
+  const auto d = emphasis::detail::gelman_rubin(H, 0, H.front().size(), [](const std::vector<double>& h, size_t i) { return h[i]; });
+  return List::create(Named("mean") = d.mean, Named("se") = d.se, Named("rhat") = d.rhat);
+}
@@ -4,6 +4,10 @@
 #include "emphasis.hpp"
 #include "plugin.hpp"
 #include "rinit.h"
+#include "rplugin.h"
+#include "rdeadline.h"
+#include "rasync.h"
+#include "rproposal.h"
 using namespace Rcpp;
 
 
@@ -20,6 +24,30 @@ namespace {
     return DataFrame::create(Named("brts") = brts, Named("n") = n, Named("t_ext") = t_ext);
   }
 
+
+  List wrap_E(const emphasis::E_step_t& E)
+  {
+    List ret;
+    List trees;
+    for (const emphasis::tree_t& tree : E.trees) {
+      trees.push_back(unpack(tree));
+    }
+    ret["trees"] = trees;
+    ret["rejected"] = E.rejected;
+    ret["rejected_overruns"] = E.rejected_overruns;
+    ret["rejected_lambda"] = E.rejected_lambda;
+    ret["rejected_zero_weights"] = E.rejected_zero_weights;
+    ret["overrun_times"] = E.overrun_times;
+    ret["lambda_times"] = E.lambda_times;
+    ret["time"] = E.elapsed;
+    ret["weights"] = E.weights;
+    ret["logf"] = E.logf;
+    ret["fhat"] = E.fhat;
+    ret["fhat_var"] = E.fhat_var;
+    ret["status"] = emphasis::status_string(E.status);
+    return ret;
+  }
+
 }
 
 
@@ -35,9 +63,20 @@ List rcpp_mce(const std::vector<double>& brts,
               const std::vector<double>& lower_bound,  
               const std::vector<double>& upper_bound,  
               double xtol_rel,                     
-              int num_threads)
+              int num_threads,
+              const std::string& sampler = "iid",
+              int replicates = 8,
+              double max_time = 0,
+              SEXP proposal = R_NilValue,
+              double seed = 0)
 {
-  auto model = emphasis::create_plugin_model(plugin);
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.seed = static_cast<uint64_t>(seed);
+  control.proposal = make_proposal(proposal);
+  auto deadline = make_deadline(max_time);
   auto E = emphasis::E_step(sample_size,
                             maxN,
                             init_pars,
@@ -46,19 +85,47 @@ List rcpp_mce(const std::vector<double>& brts,
                             soc,
                             max_missing,
                             max_lambda,
-                            num_threads);
-  List ret;
-  List trees;
-  for (const emphasis::tree_t& tree : E.trees) {
-    trees.push_back(unpack(tree));
-  }
-  ret["trees"] = trees;
-  ret["rejected"] = E.rejected;
-  ret["rejected_overruns"] = E.rejected_overruns;
-  ret["rejected_lambda"] = E.rejected_lambda;
-  ret["rejected_zero_weights"] = E.rejected_zero_weights;
-  ret["time"] = E.elapsed;
-  ret["weights"] = E.weights;
-  ret["fhat"] = E.fhat;
-  return ret;
+                            num_threads,
+                            control,
+                            false,
+                            deadline.get());
+  return wrap_E(E);
+}
+
+
+// e_cpp on a thread of its own, returns the handle for the async_*_cpp functions
+// [[Rcpp::export(name = "e_async_cpp")]]
+SEXP rcpp_mce_async(const std::vector<double>& brts,
+                    const std::vector<double>& init_pars,
+                    int sample_size,
+                    int maxN,
+                    const std::string& plugin,
+                    int soc,
+                    int max_missing,
+                    double max_lambda,
+                    int num_threads,
+                    const std::string& sampler = "iid",
+                    int replicates = 8,
+                    double max_time = 0,
+                    SEXP proposal = R_NilValue)
+{
+  std::shared_ptr<emphasis::Model> model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.proposal = make_proposal(proposal);
+  return make_r_async<emphasis::E_step_t>([=](const emphasis::deadline_t& deadline, emphasis::async_run_t&) {
+    return emphasis::E_step(sample_size,
+                            maxN,
+                            init_pars,
+                            brts,
+                            model.get(),
+                            soc,
+                            max_missing,
+                            max_lambda,
+                            num_threads,
+                            control,
+                            false,
+                            &deadline);
+  }, wrap_E, max_time);
 }
@@ -4,6 +4,11 @@
 #include "emphasis.hpp"
 #include "plugin.hpp"
 #include "rinit.h"
+#include "rplugin.h"
+#include "rconditional.h"
+#include "rdeadline.h"
+#include "rasync.h"
+#include "rproposal.h"
 using namespace Rcpp;
 
 
@@ -20,6 +25,53 @@ namespace {
     return DataFrame::create(Named("brts") = brts, Named("n") = n, Named("t_ext") = t_ext);
   }
 
+
+  List wrap_mcem(emphasis::mcem_t& mcem, bool copy_trees)
+  {
+    List ret;
+    if (copy_trees) {
+      List trees;
+      auto copy = [&](const auto& S) {
+        for (const emphasis::tree_t& tree : S.trees) {
+          trees.push_back(unpack(tree));
+        }
+        emphasis::tree_t tree;
+        for (size_t i = 0; i < S.deltas.size(); ++i) {
+          S.deltas.expand(i, tree);
+          trees.push_back(unpack(tree));
+        }
+        for (size_t i = 0; i < S.replay.size(); ++i) {
+          S.replay.expand(i, tree);
+          trees.push_back(unpack(tree));
+        }
+      };
+      if (mcem.e.pooled) copy(*mcem.e.pooled); else copy(mcem.e);
+      ret["trees"] = trees;
+    } else {
+      ret["trees"] = static_cast<int>(mcem.e.weights.size());
+    }
+    ret["rejected"] = mcem.e.rejected;
+    ret["rejected_overruns"] = mcem.e.rejected_overruns;
+    ret["rejected_lambda"] = mcem.e.rejected_lambda;
+    ret["rejected_zero_weights"] = mcem.e.rejected_zero_weights;
+    ret["overrun_times"] = mcem.e.overrun_times;
+    ret["lambda_times"] = mcem.e.lambda_times;
+    ret["estimates"] = NumericVector(mcem.m.estimates.begin(), mcem.m.estimates.end());
+    ret["nlopt"] = mcem.m.opt;
+    ret["fhat"]  = mcem.e.fhat;
+    ret["fhat_var"] = mcem.e.fhat_var;
+    ret["time"]  = mcem.e.elapsed + mcem.m.elapsed;
+    ret["weights"] = mcem.e.weights;
+    ret["logf"] = mcem.e.logf;
+    ret["ess"] = mcem.e.ess;
+    ret["pruned"] = mcem.e.pruned;
+    ret["discarded_mass"] = mcem.e.discarded_mass;
+    ret["pruned_ess"] = mcem.e.pruned_ess;
+    ret["recycled"] = mcem.e.recycled;
+    ret["status"] = emphasis::status_string(mcem.m.status);
+    return ret;
+  }
+
 }
 
 
@@ -37,15 +89,36 @@ List rcpp_mcem(const std::vector<double>& brts,
                double xtol_rel,                     
                int num_threads,
                bool copy_trees,
-               Nullable<Function> rconditional = R_NilValue) 
+               SEXP rconditional = R_NilValue,
+               SEXP pool = R_NilValue,
+               double min_ess = 0.5,
+               const std::string& sampler = "iid",
+               int replicates = 8,
+               const std::string& optimizer = "sbplx",
+               bool compact = false,
+               double max_time = 0,
+               int minibatch = 0,
+               const std::string& prune = "none",
+               double prune_threshold = 1e-6,
+               SEXP proposal = R_NilValue,
+               bool replay = false,
+               int replay_cache = 0) 
 {
-  auto model = emphasis::create_plugin_model(plugin);
-  emphasis::conditional_fun_t conditional{};
-  if (rconditional.isNotNull()) {
-    conditional = [cond= Function(rconditional)](const emphasis::param_t& pars) {
-      return as<double>( cond(NumericVector(pars.cbegin(), pars.cend())) );
-    };
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.proposal = make_proposal(proposal);
+  control.replay = replay;
+  control.replay_cache = replay_cache;
+  if (replay && !Rf_isNull(pool)) {
+    throw std::runtime_error("seed-replay storage can't be combined with a tree pool");
   }
+  auto conditional = make_conditional(rconditional);
+  auto deadline = make_deadline(max_time);
+  auto prune_control = emphasis::prune_control_t{};
+  prune_control.type = emphasis::make_prune_type(prune);
+  prune_control.threshold = prune_threshold;
   auto mcem = emphasis::mcem(sample_size,
                              maxN,
                              init_pars,
@@ -58,28 +131,104 @@ List rcpp_mcem(const std::vector<double>& brts,
                              upper_bound,
                              xtol_rel,
                              num_threads,
-                             conditional ? &conditional : nullptr);
-  if (mcem.e.trees.empty()) {
+                             conditional ? &conditional : nullptr,
+                             Rf_isNull(pool) ? nullptr : XPtr<emphasis::tree_pool_t>(pool).get(),
+                             min_ess,
+                             control,
+                             emphasis::make_m_optimizer(optimizer),
+                             compact,
+                             deadline.get(),
+                             minibatch,
+                             prune_control);
+  if (mcem.e.weights.empty() && (mcem.e.status == emphasis::run_status_t::completed)) {
     throw std::runtime_error("no trees, no optimization");
   }
-  List ret;
-  if (copy_trees) {
-    List trees;
-    for (const emphasis::tree_t& tree : mcem.e.trees) {
-      trees.push_back(unpack(tree));
-    }
-    ret["trees"] = trees;
-  } else {
-    ret["trees"] = static_cast<int>(mcem.e.trees.size());
+  return wrap_mcem(mcem, copy_trees);
+}
+
+
+
+// em_cpp on a thread of its own, returns the handle for the async_*_cpp functions.
+// The pool must not be used elsewhere while the run is in progress.
+// [[Rcpp::export(name = "em_async_cpp")]]
+SEXP rcpp_mcem_async(const std::vector<double>& brts,
+                     const std::vector<double>& init_pars,
+                     int sample_size,
+                     int maxN,
+                     const std::string& plugin,
+                     int soc,
+                     int max_missing,
+                     double max_lambda,
+                     const std::vector<double>& lower_bound,
+                     const std::vector<double>& upper_bound,
+                     double xtol_rel,
+                     int num_threads,
+                     bool copy_trees,
+                     SEXP rconditional = R_NilValue,
+                     SEXP pool = R_NilValue,
+                     double min_ess = 0.5,
+                     const std::string& sampler = "iid",
+                     int replicates = 8,
+                     const std::string& optimizer = "sbplx",
+                     bool compact = false,
+                     double max_time = 0,
+                     int minibatch = 0,
+                     const std::string& prune = "none",
+                     double prune_threshold = 1e-6,
+                     SEXP proposal = R_NilValue,
+                     bool replay = false,
+                     int replay_cache = 0)
+{
+  check_async_conditional(rconditional);
+  std::shared_ptr<emphasis::Model> model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.proposal = make_proposal(proposal);
+  control.replay = replay;
+  control.replay_cache = replay_cache;
+  if (replay && !Rf_isNull(pool)) {
+    throw std::runtime_error("seed-replay storage can't be combined with a tree pool");
   }
-  ret["rejected"] = mcem.e.rejected;
-  ret["rejected_overruns"] = mcem.e.rejected_overruns;
-  ret["rejected_lambda"] = mcem.e.rejected_lambda;
-  ret["rejected_zero_weights"] = mcem.e.rejected_zero_weights;
-  ret["estimates"] = NumericVector(mcem.m.estimates.begin(), mcem.m.estimates.end());
-  ret["nlopt"] = mcem.m.opt;
-  ret["fhat"]  = mcem.e.fhat;
-  ret["time"]  = mcem.e.elapsed + mcem.m.elapsed;
-  ret["weights"] = mcem.e.weights;
-  return ret;
-}
\ No newline at end of file
+  auto conditional = make_conditional(rconditional);
+  auto prune_control = emphasis::prune_control_t{};
+  prune_control.type = emphasis::make_prune_type(prune);
+  prune_control.threshold = prune_threshold;
+  auto tree_pool = Rf_isNull(pool) ? nullptr : XPtr<emphasis::tree_pool_t>(pool).get();
+  const auto m_optimizer = emphasis::make_m_optimizer(optimizer);
+  return make_r_async<emphasis::mcem_t>([=](const emphasis::deadline_t& deadline, emphasis::async_run_t&) mutable {
+    auto mcem = emphasis::mcem(sample_size,
+                               maxN,
+                               init_pars,
+                               brts,
+                               model.get(),
+                               soc,
+                               max_missing,
+                               max_lambda,
+                               lower_bound,
+                               upper_bound,
+                               xtol_rel,
+                               num_threads,
+                               conditional ? &conditional : nullptr,
+                               tree_pool,
+                               min_ess,
+                               control,
+                               m_optimizer,
+                               compact,
+                               &deadline,
+                               minibatch,
+                               prune_control);
+    if (mcem.e.weights.empty() && (mcem.e.status == emphasis::run_status_t::completed)) {
+      throw std::runtime_error("no trees, no optimization");
+    }
+    return mcem;
+  }, [copy_trees, model](emphasis::mcem_t& mcem) {
+    return wrap_mcem(mcem, copy_trees);     // replayed trees need the model
+  }, max_time, List::create(pool));
+}
+
+// [[Rcpp::export(name = "tree_pool_cpp")]]
+SEXP rcpp_tree_pool()
+{
+  return XPtr<emphasis::tree_pool_t>(new emphasis::tree_pool_t(), true);
+}
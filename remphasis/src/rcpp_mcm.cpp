@@ -4,6 +4,10 @@
 #include "emphasis.hpp"
 #include "plugin.hpp"
 #include "rinit.h"
+#include "rplugin.h"
+#include "rconditional.h"
+#include "rdeadline.h"
+#include "rproposal.h"
 using namespace Rcpp;
 
 
@@ -37,7 +41,10 @@ List rcpp_mcm(List e_step,
               const std::vector<double>& upper_bound,  
               double xtol_rel,                     
               int num_threads,
-              Nullable<Function> rconditional = R_NilValue)
+              SEXP rconditional = R_NilValue,
+              const std::string& optimizer = "sbplx",
+              double max_time = 0,
+              int minibatch = 0)
 {
   auto E = emphasis::E_step_t{};
   E.trees = pack(as<List>(e_step["trees"]));
@@ -52,13 +59,9 @@ List rcpp_mcm(List e_step,
   if (E.trees.empty()) {
     throw std::runtime_error("no trees, no optimization");
   }
-  auto model = emphasis::create_plugin_model(plugin);
-  emphasis::conditional_fun_t conditional{};
-  if (rconditional.isNotNull()) {
-    conditional = [cond= Function(rconditional)](const emphasis::param_t& pars) {
-      return as<double>( cond(NumericVector(pars.cbegin(), pars.cend())) );
-    };
-  }
+  auto model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  auto deadline = make_deadline(max_time);
   auto M = emphasis::M_step(init_pars, 
                             E.trees, 
                             E.weights, 
@@ -67,10 +70,65 @@ List rcpp_mcm(List e_step,
                             upper_bound, 
                             xtol_rel, 
                             num_threads, 
-                            conditional ? &conditional : nullptr);
+                            conditional ? &conditional : nullptr,
+                            emphasis::make_m_optimizer(optimizer),
+                            deadline.get(),
+                            minibatch);
   List ret;
   ret["estimates"] = NumericVector(M.estimates.begin(), M.estimates.end());
   ret["nlopt"] = M.opt;
   ret["time"]  = M.elapsed;
+  ret["status"] = emphasis::status_string(M.status);
   return ret;
 }
+
+
+// [[Rcpp::export(name = "q_cpp")]]
+NumericVector rcpp_q(List e_step,
+                     NumericMatrix pars,
+                     const std::string& plugin,
+                     SEXP rconditional = R_NilValue,
+                     int num_threads = 0)
+{
+  auto trees = pack(as<List>(e_step["trees"]));
+  auto weights = as<std::vector<double>>(e_step["weights"]);
+  std::vector<emphasis::param_t> P;
+  for (int i = 0; i < pars.nrow(); ++i) {
+    auto row = pars.row(i);
+    P.emplace_back(row.begin(), row.end());
+  }
+  auto model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  auto Q = emphasis::Q_surface(P,
+                               trees,
+                               weights,
+                               model.get(),
+                               conditional ? &conditional : nullptr,
+                               num_threads);
+  return NumericVector(Q.begin(), Q.end());
+}
+
+
+// [[Rcpp::export(name = "adapt_proposal_cpp")]]
+List rcpp_adapt_proposal(List e_step,
+                         const std::vector<double>& pars,
+                         const std::string& plugin,
+                         const std::vector<double>& lower_bound,
+                         const std::vector<double>& upper_bound,
+                         double defensive = 0.1,
+                         int num_threads = 0)
+{
+  auto E = emphasis::E_step_t{};
+  E.trees = pack(as<List>(e_step["trees"]));
+  E.weights = as<std::vector<double>>(e_step["weights"]);
+  E.logf = as<std::vector<double>>(e_step["logf"]);
+  auto model = make_plugin_model(plugin);
+  auto proposal = emphasis::adapt_proposal(pars, 
+                                           E, 
+                                           model.get(), 
+                                           defensive, 
+                                           lower_bound, 
+                                           upper_bound, 
+                                           num_threads);
+  return wrap_proposal(proposal);
+}
@@ -0,0 +1,86 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "rinit.h"
+#include "rplugin.h"
+#include "rconditional.h"
+#include "rdeadline.h"
+using namespace Rcpp;
+
+
+// [[Rcpp::export(name = "saem_cpp")]]
+List rcpp_saem(const std::vector<double>& brts,       
+               const std::vector<double>& init_pars,      
+               int sample_size,
+               int maxN,
+               const std::string& plugin,             
+               int soc,
+               int max_missing,               
+               double max_lambda,             
+               const std::vector<double>& lower_bound,  
+               const std::vector<double>& upper_bound,  
+               double xtol_rel,                     
+               int num_threads,
+               int burnin,
+               int max_iterations,
+               double alpha,
+               double tol,
+               int patience,
+               int max_pool,
+               SEXP rconditional = R_NilValue,
+               const std::string& sampler = "iid",
+               int replicates = 8,
+               bool compact = false,
+               double seed = 0,
+               double max_time = 0) 
+{
+  auto model = make_plugin_model(plugin);
+  auto conditional = make_conditional(rconditional);
+  auto deadline = make_deadline(max_time);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.seed = static_cast<uint64_t>(seed);
+  auto S = emphasis::saem(sample_size,
+                          maxN,
+                          init_pars,
+                          brts,
+                          model.get(),
+                          soc,
+                          max_missing,
+                          max_lambda,
+                          lower_bound,
+                          upper_bound,
+                          xtol_rel,
+                          num_threads,
+                          conditional ? &conditional : nullptr,
+                          burnin,
+                          max_iterations,
+                          alpha,
+                          tol,
+                          patience,
+                          max_pool,
+                          control,
+                          compact,
+                          deadline.get());
+  NumericMatrix trace(static_cast<int>(S.trace.size()), static_cast<int>(init_pars.size()));
+  for (int i = 0; i < trace.nrow(); ++i) {
+    for (int j = 0; j < trace.ncol(); ++j) {
+      trace(i, j) = S.trace[i][j];
+    }
+  }
+  List ret;
+  ret["estimates"] = NumericVector(S.estimates.begin(), S.estimates.end());
+  ret["trace"] = trace;
+  ret["fhat"] = S.fhat;
+  ret["gamma"] = S.gamma;
+  ret["iterations"] = S.iterations;
+  ret["converged"] = S.converged;
+  ret["pool_size"] = static_cast<int>(S.pool_size);
+  ret["seed"] = static_cast<double>(S.seed);
+  ret["status"] = emphasis::status_string(S.status);
+  ret["time"] = S.elapsed;
+  return ret;
+}
@@ -0,0 +1,162 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "rinit.h"
+#include "rplugin.h"
+#include "rdeadline.h"
+using namespace Rcpp;
+
+
+namespace {
+
+  DataFrame unpack(const emphasis::tree_t& tree)
+  {
+    NumericVector brts, n, t_ext;
+    for (const emphasis::node_t& node : tree) {
+      brts.push_back(node.brts);
+      n.push_back(node.n);
+      t_ext.push_back(node.t_ext);
+    }
+    return DataFrame::create(Named("brts") = brts, Named("n") = n, Named("t_ext") = t_ext);
+  }
+
+
+  emphasis::tree_t pack(const DataFrame& df)
+  {
+    emphasis::tree_t tree;
+    auto brts = as<NumericVector>(df["brts"]);
+    auto n = as<NumericVector>(df["n"]);
+    auto t_ext = as<NumericVector>(df["t_ext"]);
+    for (auto i = 0; i < brts.size(); ++i) {
+      tree.push_back(emphasis::node_t{brts[i], n[i], t_ext[i], 0.0});
+    }
+    return tree;
+  }
+
+
+  emphasis::E_shard_t as_shard(List rshard)
+  {
+    emphasis::E_shard_t S;
+    S.first = as<unsigned>(rshard["first"]);
+    S.last = as<unsigned>(rshard["last"]);
+    S.sampler.type = emphasis::make_sampler_type(as<std::string>(rshard["sampler"]));
+    S.sampler.replicates = as<int>(rshard["replicates"]);
+    S.sampler.seed = static_cast<uint64_t>(as<double>(rshard["seed"]));
+    auto outcome = as<RawVector>(rshard["outcome"]);
+    S.outcome.assign(outcome.begin(), outcome.end());
+    if (rshard.containsElementNamed("reject_time")) {
+      auto reject_time = as<NumericVector>(rshard["reject_time"]);
+      S.reject_time.assign(reject_time.begin(), reject_time.end());
+    }
+    else {
+      S.reject_time.assign(S.outcome.size(), 0.f);
+    }
+    S.index = as<std::vector<unsigned>>(rshard["index"]);
+    auto trees = as<List>(rshard["trees"]);
+    for (auto it = trees.cbegin(); it != trees.cend(); ++it) {
+      S.e.trees.emplace_back(pack(DataFrame(*it)));
+    }
+    S.e.weights = as<std::vector<double>>(rshard["log_weights"]);
+    S.e.logf = as<std::vector<double>>(rshard["logf"]);
+    S.e.logg = as<std::vector<double>>(rshard["logg"]);
+    S.e.elapsed = as<double>(rshard["time"]);
+    const auto status = as<std::string>(rshard["status"]);
+    if (status != "completed") {
+      S.e.status = (status == "cancelled") ? emphasis::run_status_t::cancelled : emphasis::run_status_t::deadline;
+    }
+    return S;
+  }
+
+}
+
+
+// [[Rcpp::export(name = "e_shard_cpp")]]
+List rcpp_e_shard(const std::vector<double>& brts,
+                  const std::vector<double>& init_pars,
+                  int first,
+                  int last,
+                  const std::string& plugin,
+                  int soc,
+                  int max_missing,
+                  double max_lambda,
+                  int num_threads,
+                  double seed,
+                  const std::string& sampler = "iid",
+                  int replicates = 8,
+                  double max_time = 0)
+{
+  if ((first < 0) || (last < first)) {
+    throw std::runtime_error("invalid shard range");
+  }
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::sampler_control_t{};
+  control.type = emphasis::make_sampler_type(sampler);
+  control.replicates = replicates;
+  control.seed = static_cast<uint64_t>(seed);
+  auto deadline = make_deadline(max_time);
+  auto S = emphasis::E_shard(static_cast<unsigned>(first),
+                             static_cast<unsigned>(last),
+                             init_pars,
+                             brts,
+                             model.get(),
+                             soc,
+                             max_missing,
+                             max_lambda,
+                             num_threads,
+                             control,
+                             false,
+                             deadline.get());
+  List trees;
+  for (const emphasis::tree_t& tree : S.e.trees) {
+    trees.push_back(unpack(tree));
+  }
+  List ret;
+  ret["first"] = first;
+  ret["last"] = last;
+  ret["seed"] = seed;
+  ret["sampler"] = sampler;
+  ret["replicates"] = replicates;
+  ret["outcome"] = RawVector(S.outcome.begin(), S.outcome.end());
+  ret["reject_time"] = NumericVector(S.reject_time.begin(), S.reject_time.end());
+  ret["index"] = IntegerVector(S.index.begin(), S.index.end());
+  ret["trees"] = trees;
+  ret["log_weights"] = S.e.weights;
+  ret["logf"] = S.e.logf;
+  ret["logg"] = S.e.logg;
+  ret["rejected"] = S.e.rejected;
+  ret["time"] = S.e.elapsed;
+  ret["status"] = emphasis::status_string(S.e.status);
+  return ret;
+}
+
+
+// [[Rcpp::export(name = "e_merge_cpp")]]
+List rcpp_e_merge(List shards, int sample_size = 0)
+{
+  std::vector<emphasis::E_shard_t> S;
+  for (auto it = shards.cbegin(); it != shards.cend(); ++it) {
+    S.emplace_back(as_shard(as<List>(*it)));
+  }
+  auto E = emphasis::merge_shards(S, sample_size);
+  List ret;
+  List trees;
+  for (const emphasis::tree_t& tree : E.trees) {
+    trees.push_back(unpack(tree));
+  }
+  ret["trees"] = trees;
+  ret["rejected"] = E.rejected;
+  ret["rejected_overruns"] = E.rejected_overruns;
+  ret["rejected_lambda"] = E.rejected_lambda;
+  ret["rejected_zero_weights"] = E.rejected_zero_weights;
+  ret["overrun_times"] = E.overrun_times;
+  ret["lambda_times"] = E.lambda_times;
+  ret["time"] = E.elapsed;
+  ret["weights"] = E.weights;
+  ret["fhat"] = E.fhat;
+  ret["fhat_var"] = E.fhat_var;
+  ret["ess"] = E.ess;
+  ret["status"] = emphasis::status_string(E.status);
+  return ret;
+}
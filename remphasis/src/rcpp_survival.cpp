@@ -0,0 +1,34 @@
+// [[Rcpp::plugins(cpp14)]]
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+#include "survival.hpp"
+#include "plugin.hpp"
+#include "rinit.h"
+#include "rplugin.h"
+using namespace Rcpp;
+
+
+// [[Rcpp::export(name = "survival_cpp")]]
+NumericVector rcpp_survival(NumericMatrix pars,
+                            double age,
+                            const std::string& plugin,
+                            int soc = 2,
+                            int simulations = 10000,
+                            int max_lineages = 1000,
+                            double seed = 0,
+                            int num_threads = 0)
+{
+  auto model = make_plugin_model(plugin);
+  auto control = emphasis::survival_control_t{};
+  control.simulations = simulations;
+  control.max_lineages = max_lineages;
+  control.seed = static_cast<uint64_t>(seed);
+  std::vector<emphasis::param_t> P;
+  for (int i = 0; i < pars.nrow(); ++i) {
+    auto row = pars.row(i);
+    P.emplace_back(row.begin(), row.end());
+  }
+  auto prob = emphasis::survival_prob(P, age, model.get(), soc, control, num_threads);
+  return NumericVector(prob.begin(), prob.end());
+}
@@ -0,0 +1,33 @@
+#ifndef EMPHASIS_RDEADLINE_H_INCLUDED
+#define EMPHASIS_RDEADLINE_H_INCLUDED
+
+#include <memory>
+#include <Rcpp.h>
+#include "deadline.hpp"
+
+
+namespace {
+
+  void check_interrupt_fn(void*) 
+  { 
+    R_CheckUserInterrupt(); 
+  }
+
+}
+
+
+// true if the user pressed Ctrl-C; R thread only, doesn't longjmp
+inline bool r_interrupt_pending()
+{
+  return FALSE == R_ToplevelExec(check_interrupt_fn, nullptr);
+}
+
+
+// deadline with budget max_time [s] that polls R user interrupts.
+// Must be created on the R thread.
+inline std::unique_ptr<emphasis::deadline_t> make_deadline(double max_time)
+{
+  return std::unique_ptr<emphasis::deadline_t>(new emphasis::deadline_t(max_time, &r_interrupt_pending));
+}
+
+#endif
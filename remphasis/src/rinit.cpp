@@ -13,6 +13,8 @@ nlopt_result(*remp_set_upper_bounds)(nlopt_opt, const double *) = NULL;
 nlopt_result(*remp_set_upper_bounds1)(nlopt_opt, double) = NULL;
 nlopt_result(*remp_set_xtol_rel)(nlopt_opt, double) = NULL;
 nlopt_result(*remp_set_xtol_abs)(nlopt_opt, double) = NULL;
+nlopt_result(*remp_force_stop)(nlopt_opt) = NULL;
+nlopt_result(*remp_set_initial_step)(nlopt_opt, const double *) = NULL;
 
 
 // [[Rcpp::init]]
@@ -29,4 +31,6 @@ void remphasis_init(DllInfo *dll)
   remp_set_upper_bounds1 = (nlopt_result(*)(nlopt_opt, double)) R_GetCCallable("nloptr","nlopt_set_upper_bounds1");
   remp_set_xtol_rel = (nlopt_result(*)(nlopt_opt, double)) R_GetCCallable("nloptr","nlopt_set_xtol_rel");
   remp_set_xtol_abs = (nlopt_result(*)(nlopt_opt, double)) R_GetCCallable("nloptr","nlopt_set_xtol_abs");
+  remp_force_stop = (nlopt_result(*)(nlopt_opt)) R_GetCCallable("nloptr","nlopt_force_stop");
+  remp_set_initial_step = (nlopt_result(*)(nlopt_opt, const double *)) R_GetCCallable("nloptr","nlopt_set_initial_step");
 }
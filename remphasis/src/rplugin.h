@@ -0,0 +1,16 @@
+#ifndef EMPHASIS_RPLUGIN_H_INCLUDED
+#define EMPHASIS_RPLUGIN_H_INCLUDED
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+
+
+// plugin model from R. With options(remphasis.isolate_plugins = TRUE),
+// non-thread-safe plugins run in private per-thread copies.
+inline std::unique_ptr<emphasis::Model> make_plugin_model(const std::string& plugin)
+{
+  SEXP isolate = Rf_GetOption1(Rf_install("remphasis.isolate_plugins"));
+  return emphasis::create_plugin_model(plugin, !Rf_isNull(isolate) && Rcpp::as<bool>(isolate));
+}
+
+#endif
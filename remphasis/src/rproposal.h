@@ -0,0 +1,48 @@
+#ifndef EMPHASIS_RPROPOSAL_H_INCLUDED
+#define EMPHASIS_RPROPOSAL_H_INCLUDED
+
+#include <Rcpp.h>
+#include "emphasis.hpp"
+
+
+// proposal from R: NULL (the target parameters) or a list with
+// components pars (matrix, one component per row), weights and defensive
+inline emphasis::proposal_t make_proposal(SEXP rproposal)
+{
+  using namespace Rcpp;
+  auto proposal = emphasis::proposal_t{};
+  if (Rf_isNull(rproposal)) {
+    return proposal;
+  }
+  List p(rproposal);
+  auto pars = as<NumericMatrix>(p["pars"]);
+  for (int i = 0; i < pars.nrow(); ++i) {
+    auto row = pars.row(i);
+    proposal.pars.emplace_back(row.begin(), row.end());
+  }
+  if (p.containsElementNamed("weights") && !Rf_isNull(p["weights"])) {
+    proposal.weights = as<std::vector<double>>(p["weights"]);
+  }
+  if (p.containsElementNamed("defensive")) {
+    proposal.defensive = as<double>(p["defensive"]);
+  }
+  return proposal;
+}
+
+
+inline Rcpp::List wrap_proposal(const emphasis::proposal_t& proposal)
+{
+  using namespace Rcpp;
+  const int n = proposal.pars.empty() ? 0 : static_cast<int>(proposal.pars.front().size());
+  NumericMatrix pars(static_cast<int>(proposal.pars.size()), n);
+  for (int i = 0; i < pars.nrow(); ++i) {
+    for (int j = 0; j < n; ++j) {
+      pars(i, j) = proposal.pars[i][j];
+    }
+  }
+  return List::create(Named("pars") = pars,
+                      Named("weights") = proposal.weights,
+                      Named("defensive") = proposal.defensive);
+}
+
+#endif
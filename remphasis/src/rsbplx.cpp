@@ -6,80 +6,6 @@
 namespace emphasis {
 
 
-  sbplx_1::sbplx_1() : lower_(-std::numeric_limits<double>::max()),
-    upper_(+std::numeric_limits<double>::max())
-  {
-    nlopt_ = remp_create(NLOPT_LN_SBPLX, 1);
-    if (nullptr == nlopt_) {
-      throw emphasis_error("nlopt_create failed");
-    }
-  }
-
-
-  sbplx_1::~sbplx_1()
-  {
-    if (nlopt_) remp_destroy(nlopt_);
-  }
-
-
-  void sbplx_1::set_xtol_rel(double val)
-  {
-    if (NLOPT_SUCCESS > (result_ = remp_set_xtol_rel(nlopt_, val))) {
-      throw emphasis::emphasis_error("nlopt_set_xtol_failed");
-    }
-  }
-
-
-  void sbplx_1::set_lower_bounds(double val)
-  {
-    lower_ = val;
-    if (NLOPT_SUCCESS > (result_ = remp_set_lower_bounds1(nlopt_, lower_))) {
-      throw emphasis_error("nlopt_set_lower_bounds failed");
-    }
-  }
-
-
-  void sbplx_1::set_upper_bounds(double val)
-  {
-    upper_ = val;
-    if (NLOPT_SUCCESS > (result_ = remp_set_upper_bounds1(nlopt_, upper_))) {
-      throw emphasis_error("nlopt_set_upper_bounds failed");
-    }
-  }
-
-
-  void sbplx_1::set_min_objective(nlopt_func dx, void* fdata)
-  {
-    if (NLOPT_SUCCESS > (result_ = remp_set_min_objective(nlopt_, dx, fdata))) {
-      throw emphasis_error("nlopt_set_min_objective failed");
-    }
-  }
-
-
-  void sbplx_1::set_max_objective(nlopt_func dx, void* fdata)
-  {
-    if (NLOPT_SUCCESS > (result_ = remp_set_max_objective(nlopt_, dx, fdata))) {
-      throw emphasis_error("nlopt_set_max_objective failed");
-    }
-  }
-
-
-  double sbplx_1::optimize(double& x)
-  {
-    double fmin = 0.0;
-    if (NLOPT_SUCCESS > (result_ = remp_optimize(nlopt_, &x, &fmin))) {
-      throw emphasis_error("optimize failed");
-    }
-    return fmin;
-  }
-
-
-  nlopt_result sbplx_1::result()
-  {
-    return result_;
-  }
-
-
   sbplx::sbplx(size_t nparams)
     : lower_(nparams, -std::numeric_limits<double>::max()),
     upper_(nparams, +std::numeric_limits<double>::max())
@@ -122,6 +48,14 @@ namespace emphasis {
     }
   }
 
+
+  void sbplx::set_initial_step(const std::vector<double>& dx)
+  {
+    if (NLOPT_SUCCESS > (result_ = remp_set_initial_step(nlopt_, dx.data()))) {
+      throw emphasis_error("nlopt_set_initial_step failed");
+    }
+  }
+
   void sbplx::set_min_objective(nlopt_func dx, void* fdata)
   {
     if (NLOPT_SUCCESS > (result_ = remp_set_min_objective(nlopt_, dx, fdata))) {
@@ -141,13 +75,20 @@ namespace emphasis {
   double sbplx::optimize(std::vector<double>& x)
   {
     double fmin = 0.0;
-    if (NLOPT_SUCCESS > (result_ = remp_optimize(nlopt_, x.data(), &fmin))) {
+    result_ = remp_optimize(nlopt_, x.data(), &fmin);
+    if ((NLOPT_SUCCESS > result_) && (NLOPT_FORCED_STOP != result_)) {
       throw emphasis_error("optimize failed");
     }
     return fmin;
   }
 
 
+  void sbplx::force_stop()
+  {
+    remp_force_stop(nlopt_);
+  }
+
+
   nlopt_result sbplx::result()
   {
     return result_;
@@ -0,0 +1,207 @@
+#include <cmath>
+#include <chrono>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include "emphasis.hpp"
+#include "plugin.hpp"
+#include "weights.hpp"
+#include "qmc.hpp"
+#include "model_helpers.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    constexpr uint64_t resample_stream = uint64_t(1) << 43;   // stream of the resample offset
+    constexpr size_t min_batches = 5;                         // of the batch-means standard error
+
+
+    // weighted tree pool representing the stochastic approximation of Q.
+    // Holds either trees or, for compact E-steps, deltas.
+    class saem_pool
+    {
+    public:
+      explicit saem_pool(size_t max_size) : max_size_(max_size) {}
+
+      // Q = (1 - gamma) Q + gamma Q_hat
+      void update(double gamma, E_step_t& E)
+      {
+        for (auto& w : weights_) w *= (1.0 - gamma);
+        const double sum_w = std::accumulate(E.weights.cbegin(), E.weights.cend(), 0.0);
+        if (!E.deltas.empty() && deltas_.empty()) {
+          deltas_ = delta_trees(E.deltas.backbone());
+        }
+        for (size_t i = 0; i < E.deltas.size(); ++i) {
+          deltas_.push_back(E.deltas, i);
+        }
+        for (size_t i = 0; i < E.trees.size(); ++i) {
+          trees_.emplace_back(std::move(E.trees[i]));
+        }
+        for (size_t i = 0; i < E.weights.size(); ++i) {
+          weights_.push_back(gamma * E.weights[i] / sum_w);
+        }
+        prune(E.seed);
+      }
+
+      const std::vector<tree_t>& trees() const { return trees_; }
+      const delta_trees& deltas() const { return deltas_; }
+      const std::vector<double>& weights() const { return weights_; }
+      size_t size() const { return weights_.size(); }
+
+    private:
+      // drops zero weights. Beyond max_size, the pool is resampled
+      // proportional to the weights, which keeps Q unbiased.
+      void prune(uint64_t seed)
+      {
+        std::vector<size_t> idx;
+        std::vector<double> w;
+        for (size_t i = 0; i < weights_.size(); ++i) {
+          if (weights_[i] > 0.0) {
+            idx.push_back(i);
+            w.push_back(weights_[i]);
+          }
+        }
+        if (idx.size() > max_size_) {
+          const double u = static_cast<double>(detail::stream_seed(seed, resample_stream) >> 11) * (1.0 / 9007199254740992.0);
+          std::vector<size_t> drawn;
+          std::vector<double> sw;
+          detail::systematic_resample(w, max_size_, u, drawn, sw);
+          for (auto& i : drawn) i = idx[i];
+          idx = std::move(drawn);
+          w = std::move(sw);
+        }
+        if (!deltas_.empty()) {
+          if (idx.size() != deltas_.size()) {
+            delta_trees kept(deltas_.backbone());
+            for (auto i : idx) kept.push_back(deltas_, i);
+            deltas_ = std::move(kept);
+          }
+        }
+        else {
+          // idx is ascending
+          for (size_t j = 0; j < idx.size(); ++j) {
+            if (j != idx[j]) trees_[j] = std::move(trees_[idx[j]]);
+          }
+          trees_.resize(idx.size());
+        }
+        weights_ = std::move(w);
+      }
+
+      size_t max_size_;
+      std::vector<tree_t> trees_;
+      delta_trees deltas_;
+      std::vector<double> weights_;
+    };
+
+
+    // max. relative batch-means standard error of the mean of trace[first, last).
+    // The trailing floor(sqrt(n)) * b iterates form b = floor(sqrt(n)) batches;
+    // infinite below min_batches.
+    double rel_batch_means_se(const std::vector<param_t>& trace, size_t first, size_t last, const param_t& avg)
+    {
+      const size_t b = static_cast<size_t>(std::sqrt(static_cast<double>(last - first)));
+      if (b < min_batches) return std::numeric_limits<double>::infinity();
+      const size_t m = (last - first) / b;
+      first = last - b * m;
+      double r = 0.0;
+      for (size_t j = 0; j < avg.size(); ++j) {
+        std::vector<double> bm(b, 0.0);
+        for (size_t i = first; i < last; ++i) {
+          bm[(i - first) / m] += trace[i][j] / static_cast<double>(m);
+        }
+        const double mean = std::accumulate(bm.cbegin(), bm.cend(), 0.0) / static_cast<double>(b);
+        double ss = 0.0;
+        for (auto x : bm) ss += (x - mean) * (x - mean);
+        const double se = std::sqrt(ss / static_cast<double>(b - 1) / static_cast<double>(b));
+        r = std::max(r, se / std::max(std::abs(avg[j]), 1e-10));
+      }
+      return r;
+    }
+
+  }
+
+
+  saem_t saem(int N,
+              int maxN,
+              const param_t& pars,
+              const brts_t& brts,
+              class Model* model,
+              int soc,
+              int max_missing,
+              double max_lambda,
+              const param_t& lower_bound,
+              const param_t& upper_bound,
+              double xtol_rel,
+              int num_threads,
+              conditional_fun_t* conditional,
+              int burnin,
+              int max_iterations,
+              double alpha,
+              double tol,
+              int patience,
+              int max_pool,
+              const sampler_control_t& sampler,
+              bool compact,
+              const deadline_t* deadline)
+  {
+    if (sampler.replay) {
+      throw emphasis_error("seed-replay storage isn't supported by saem");
+    }
+    auto T0 = std::chrono::high_resolution_clock::now();
+    auto S = saem_t{};
+    S.seed = sampler.seed ? sampler.seed : detail::make_random_engine<detail::reng_t>()();
+    S.trace.reserve(max_iterations);
+    S.fhat.reserve(max_iterations);
+    S.gamma.reserve(max_iterations);
+    saem_pool pool((max_pool > 0) ? max_pool : 10 * N);
+    param_t theta = pars;
+    param_t avg(pars.size(), 0.0);
+    int calm = 0;
+    for (int k = 1; k <= max_iterations; ++k) {
+      if (deadline && deadline->check()) {
+        S.status = deadline->status();
+        break;
+      }
+      auto E_sampler = sampler;
+      E_sampler.seed = detail::stream_seed(S.seed, static_cast<uint64_t>(k));   // fresh streams per E-step
+      auto E = E_step(N, maxN, theta, brts, model, soc, max_missing, max_lambda, num_threads, E_sampler, compact, deadline);
+      if (E.status != run_status_t::completed) {
+        S.status = E.status;    // drop the incomplete iteration
+        break;
+      }
+      const double gamma = (k <= burnin) ? 1.0 : std::pow(static_cast<double>(k - burnin), -alpha);
+      pool.update(gamma, E);
+      auto M = compact ? M_step(theta, pool.deltas(), pool.weights(), model, lower_bound, upper_bound, xtol_rel, num_threads, conditional, m_optimizer_t::sbplx, deadline)
+                       : M_step(theta, pool.trees(), pool.weights(), model, lower_bound, upper_bound, xtol_rel, num_threads, conditional, m_optimizer_t::sbplx, deadline);
+      if (M.status != run_status_t::completed) {
+        S.status = M.status;
+        break;
+      }
+      S.fhat.push_back(E.fhat);
+      S.gamma.push_back(gamma);
+      theta = M.estimates;
+      S.trace.push_back(theta);
+      S.iterations = k;
+      if (k > burnin) {
+        // Polyak-Ruppert average, converged once its standard error is small
+        const double n = static_cast<double>(k - burnin);
+        for (size_t i = 0; i < avg.size(); ++i) {
+          avg[i] += (theta[i] - avg[i]) / n;
+        }
+        calm = (rel_batch_means_se(S.trace, burnin, S.trace.size(), avg) < tol) ? calm + 1 : 0;
+        if (calm >= patience) {
+          S.converged = true;
+          break;
+        }
+      }
+    }
+    S.estimates = (S.iterations > burnin) ? avg : theta;
+    S.pool_size = pool.size();
+    auto T1 = std::chrono::high_resolution_clock::now();
+    S.elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(T1 - T0).count());
+    return S;
+  }
+
+}
@@ -0,0 +1,187 @@
+#include <cmath>
+#include <algorithm>
+#include <tbb/tbb.h>
+#include "survival.hpp"
+#include "model_helpers.hpp"
+#include "qmc.hpp"
+#include "maximize_1d.hpp"
+
+
+namespace emphasis {
+
+  namespace {
+
+    constexpr int bound_pieces = 32;              // pieces of the age with a thinning bound each
+
+
+    // lineages alive in the forward simulation
+    struct lineages_t
+    {
+      std::vector<double> birth;
+      std::vector<unsigned char> clade;           // crown lineage of origin
+      double sum_birth = 0.0;
+      unsigned alive[2] = { 0, 0 };               // per clade
+
+      double n() const noexcept { return static_cast<double>(birth.size()); }
+      double pd(double t) const noexcept { return n() * t - sum_birth; }
+    };
+
+
+    // forward simulation with thinning. The bound of a piece is the numerical
+    // maximum of the total rate with a safety margin, as in augment_tree, and is
+    // kept for thinned proposals until the lineages change.
+    bool survives(const param_t& pars, double age, const Model* model, int soc, int max_lineages, detail::reng_t& reng, lineages_t& L)
+    {
+      L.birth.assign(soc, 0.0);
+      L.clade.assign(soc, 0);
+      if (soc == 2) L.clade[1] = 1;
+      L.sum_birth = 0.0;
+      L.alive[0] = 1;
+      L.alive[1] = (soc == 2) ? 1 : 0;
+      double rates[2];
+      auto total_rate = [&](double t) {
+        model->bd_rates(t, pars, L.n(), L.pd(t), rates);
+        return L.n() * (rates[0] + rates[1]);
+      };
+      const double piece = age / bound_pieces;
+      double t = 0.0;
+      double t1 = 0.0;
+      double bound = 0.0;
+      bool stale = true;            // bound doesn't cover [t, t1]
+      while (t < age) {
+        if (static_cast<int>(L.birth.size()) >= max_lineages) {
+          return true;
+        }
+        if (stale) {
+          t1 = std::min(age, t + piece);
+          bound = (1.0 + EMPHASIS_LAMBDA_SAFETY_MARGIN) * detail::maximize_1d(total_rate, t, t1, EMPHASIS_LAMBDA_MAX_EVALS, EMPHASIS_LAMBDA_XTOL_REL);
+          stale = false;
+        }
+        const double dt = (bound > 0.0) ? -std::log(detail::uniform(reng)) / bound : detail::huge;
+        if (t + dt >= t1) {
+          t = t1;
+          stale = true;
+          continue;
+        }
+        t += dt;
+        const double rate = total_rate(t);
+        const double u = detail::uniform(reng) * bound;
+        if (u > rate) {
+          continue;   // thinned
+        }
+        stale = true;
+        const size_t k = std::min(L.birth.size() - 1, static_cast<size_t>(detail::uniform(reng) * L.n()));
+        if (u <= L.n() * rates[0]) {
+          // speciation of lineage k
+          L.birth.push_back(t);
+          L.clade.push_back(L.clade[k]);
+          L.sum_birth += t;
+          ++L.alive[L.clade[k]];
+        }
+        else {
+          // extinction of lineage k
+          L.sum_birth -= L.birth[k];
+          if (0 == --L.alive[L.clade[k]]) {
+            return false;
+          }
+          L.birth[k] = L.birth.back();
+          L.clade[k] = L.clade.back();
+          L.birth.pop_back();
+          L.clade.pop_back();
+        }
+      }
+      return true;
+    }
+
+
+    thread_local lineages_t pooled_lineages;
+
+  }
+
+
+  std::vector<double> survival_prob(const std::vector<param_t>& pars,
+                                    double age,
+                                    Model* model,
+                                    int soc,
+                                    const survival_control_t& control,
+                                    int num_threads)
+  {
+    if ((soc != 1) && (soc != 2)) throw emphasis_error("survival_prob: soc must be 1 or 2");
+    if (!(age > 0.0)) throw emphasis_error("survival_prob: age must be positive");
+    if (control.simulations < 1) throw emphasis_error("survival_prob: no simulations");
+    double rates[2];
+    if (!model->bd_rates(0.0, param_t(model->nparams(), 0.0), 1.0, 0.0, rates)) {
+      throw emphasis_error("model doesn't provide the forward process (emp_bd_rates)");
+    }
+    if (!model->is_threadsafe()) num_threads = 1;
+    tbb::task_scheduler_init _tbb((num_threads > 0) ? num_threads : tbb::task_scheduler_init::automatic);
+    const uint64_t seed = (control.seed != 0) ? control.seed : detail::make_random_engine<detail::reng_t>()();
+    const size_t S = static_cast<size_t>(control.simulations);
+    std::vector<double> prob(pars.size(), 0.0);
+    tbb::parallel_for(size_t(0), pars.size(), [&](size_t p) {
+      const int survived = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, S), 0,
+        [&](const tbb::blocked_range<size_t>& r, int count) {
+          for (size_t s = r.begin(); s < r.end(); ++s) {
+            detail::reng_t reng(detail::stream_seed(seed, s));
+            count += survives(pars[p], age, model, soc, control.max_lineages, reng, pooled_lineages);
+          }
+          return count;
+        },
+        std::plus<int>());
+      prob[p] = static_cast<double>(survived) / S;
+    });
+    return prob;
+  }
+
+
+  conditional_grid survival_grid(const param_t& lower,
+                                 const param_t& upper,
+                                 const std::vector<int>& n,
+                                 double age,
+                                 Model* model,
+                                 int soc,
+                                 const survival_control_t& control,
+                                 int num_threads)
+  {
+    if ((lower.size() != upper.size()) || n.empty()) {
+      throw emphasis_error("survival_grid: invalid parameter box");
+    }
+    std::vector<std::vector<double>> axes(lower.size());
+    size_t size = 1;
+    for (size_t j = 0; j < lower.size(); ++j) {
+      const int nj = (upper[j] > lower[j]) ? std::max(2, n[j % n.size()]) : 1;
+      for (int i = 0; i < nj; ++i) {
+        axes[j].push_back((nj > 1) ? lower[j] + i * (upper[j] - lower[j]) / (nj - 1) : lower[j]);
+      }
+      size *= axes[j].size();
+    }
+    // grid points, first axis varies fastest
+    std::vector<param_t> pars(size, param_t(lower.size()));
+    for (size_t k = 0; k < size; ++k) {
+      size_t rem = k;
+      for (size_t j = 0; j < axes.size(); ++j) {
+        pars[k][j] = axes[j][rem % axes[j].size()];
+        rem /= axes[j].size();
+      }
+    }
+    auto values = survival_prob(pars, age, model, soc, control, num_threads);
+    return conditional_grid(std::move(axes), std::move(values));
+  }
+
+
+  conditional_fun_t survival_conditional(double age,
+                                         Model* model,
+                                         int soc,
+                                         const survival_control_t& control,
+                                         int num_threads)
+  {
+    auto c = control;
+    if (c.seed == 0) {
+      c.seed = detail::make_random_engine<detail::reng_t>()();    // common random numbers across calls
+    }
+    return [=](const param_t& pars) {
+      return survival_prob({ pars }, age, model, soc, c, num_threads).front();
+    };
+  }
+
+}
@@ -5,14 +5,6 @@
 using namespace emphasis::detail;
 
 
-namespace {
-
-  using reng_t = std::mt19937_64;   // we need doubles
-  static thread_local reng_t reng_ = make_random_engine<reng_t>();
-
-}
-
-
 inline double speciation_rate(const double* pars, const emp_node_t& node)
 {
   const double lambda = pars[1] + pars[2] * node.n;
@@ -23,12 +15,13 @@ inline double speciation_rate(const double* pars, const emp_node_t& node)
 EMP_EXTERN(const char*) emp_description() { return "rpd1 model, dynamic link library."; }
 EMP_EXTERN(bool) emp_is_threadsafe() { return true; }
 EMP_EXTERN(bool) emp_numerical_max_lambda() { return false; }
+EMP_EXTERN(void) emp_set_random_stream(emp_random_stream_func accessor) { random_stream_accessor() = accessor; }
 EMP_EXTERN(int) emp_nparams() { return 3; }
 
 
 EMP_EXTERN(double) emp_extinction_time(double t_speciation, const double* pars, unsigned n, const emp_node_t* tree)
 {
-  return t_speciation + trunc_exp(tree[n - 1].brts - t_speciation, pars[0], reng_);
+  return t_speciation + trunc_exp(tree[n - 1].brts - t_speciation, pars[0], random_stream());
 }
 
 
@@ -87,6 +80,50 @@ EMP_EXTERN(double) emp_loglik(const double* pars, unsigned n, const emp_node_t*
 }
 
 
+// loglik and sampling_prob in one pass
+EMP_EXTERN(double) emp_log_weight(const double* pars, unsigned n, const emp_node_t* tree, double* logf, double* logg)
+{
+  mu_integral muint(pars[0], tree[n - 1].brts);
+  log_sum log_lambda{};
+  int cex = 0;
+  double inte_f = 0.0;
+  double inte_g = 0.0;
+  double log_missing = 0.0;
+  double prev_brts = 0.0;
+  double tips = tree[0].n;
+  double Ne = 0.0;
+  for (unsigned i = 0; i < n; ++i) {
+    const auto& node = tree[i];
+    const double lambda = speciation_rate(pars, node);
+    if (is_extinction(node)) {
+      ++cex;
+    }
+    else if (i != n - 1) {
+      log_lambda += lambda;
+    }
+    inte_f += (node.brts - prev_brts) * node.n * (lambda + pars[0]);
+    inte_g += node.n * lambda * muint(prev_brts, node.brts);
+    tips += is_tip(node);
+    Ne -= is_extinction(node);
+    if (is_missing(node)) {
+      const double lifespan = node.t_ext - node.brts;
+      log_missing += std::log(node.n * pars[0] * lambda) - pars[0] * lifespan - std::log(2.0 * tips + Ne++);
+    }
+    prev_brts = node.brts;
+  }
+  *logf = std::log(pars[0]) * cex + log_lambda.result() - inte_f;
+  *logg = log_missing - inte_g;
+  return *logf - *logg;
+}
+
+
+EMP_EXTERN(void) emp_bd_rates(double t, const double* pars, double n, double pd, double* rates)
+{
+  rates[0] = std::max(0.0, pars[1] + pars[2] * n);
+  rates[1] = pars[0];
+}
+
+
 EMP_EXTERN(void) emp_lower_bound(double* pars)
 {
   pars[0] = 10e-9; pars[1] = 10e-9; pars[2] = -100.0;
@@ -7,8 +7,88 @@ using namespace emphasis::detail;
 
 namespace {
 
-  using reng_t = std::mt19937_64;   // we need doubles
-  static thread_local reng_t reng_ = make_random_engine<reng_t>();
+  // per-augmentation state: reconstructed pd within the current branching interval.
+  // pd(t) = pd0_ + (t - t0_) * ni_ for tree[c_ - 1].brts <= t < tree[c_].brts
+  class pd_cursor
+  {
+  public:
+    double pd(double t, unsigned n, const emp_node_t* tree)
+    {
+      if (!valid_ || ((c_ > 0) && (t < tree[c_ - 1].brts))) {
+        rescan(t, n, tree);
+      }
+      while ((c_ < n) && (tree[c_].brts < t)) {
+        if (is_extinction(tree[c_])) {
+          rescan(t, n, tree);
+          break;
+        }
+        step(n, tree);
+      }
+      if ((c_ < n) && (tree[c_].brts == t) && is_extinction(tree[c_])) {
+        // right boundary at extinction node: don't move the cursor
+        if (!peek_valid_) {
+          peek_pd_ = calculate_pd(t, n, tree);
+          peek_valid_ = true;
+        }
+        return peek_pd_;
+      }
+      return pd0_ + (t - t0_) * ni_;
+    }
+
+    // equivalent to lower_bound_node(t, n, tree) after pd(t)
+    const emp_node_t* node(double t, unsigned n, const emp_node_t* tree) const
+    {
+      unsigned i = c_;
+      while ((i > 0) && (tree[i - 1].brts == t)) --i;
+      return tree + std::min(i, n - 1);
+    }
+
+    void invalidate(double t0)
+    {
+      if (t0 <= hi_) {
+        valid_ = false;
+      }
+      peek_valid_ = false;
+    }
+
+  private:
+    void rescan(double t, unsigned n, const emp_node_t* tree)
+    {
+      auto it = std::upper_bound(tree, tree + n, t, node_less{});
+      c_ = static_cast<unsigned>(it - tree);
+      const double lo = (c_ > 0) ? tree[c_ - 1].brts : 0.0;
+      pd0_ = t0_ = 0.0;
+      ni_ = tree[0].n;
+      for (unsigned i = 0; i < c_; ++i) {
+        if (tree[i].t_ext > lo) {
+          pd0_ += (tree[i].brts - t0_) * ni_++;
+          t0_ = tree[i].brts;
+        }
+      }
+      hi_ = (c_ < n) ? tree[c_].brts : huge;
+      valid_ = true;
+      peek_valid_ = false;
+    }
+
+    // crosses non-extinction node
+    void step(unsigned n, const emp_node_t* tree)
+    {
+      const double brts = tree[c_].brts;
+      pd0_ += (brts - t0_) * ni_++;
+      t0_ = brts;
+      hi_ = (++c_ < n) ? tree[c_].brts : huge;
+      peek_valid_ = false;
+    }
+
+    unsigned c_ = 0;      // number of nodes with brts <= t
+    double pd0_ = 0.0;
+    double t0_ = 0.0;
+    double ni_ = 0.0;
+    double hi_ = huge;
+    bool valid_ = false;
+    double peek_pd_ = 0.0;
+    bool peek_valid_ = false;
+  };
 
 }
 
@@ -23,12 +103,13 @@ inline double speciation_rate(const double* pars, const emp_node_t& node)
 EMP_EXTERN(const char*) emp_description() { return "rpd5c model, dynamic link library."; }
 EMP_EXTERN(bool) emp_is_threadsafe() { return true; }
 EMP_EXTERN(bool) emp_numerical_max_lambda() { return false; }
+EMP_EXTERN(void) emp_set_random_stream(emp_random_stream_func accessor) { random_stream_accessor() = accessor; }
 EMP_EXTERN(int) emp_nparams() { return 4; }
 
 
 EMP_EXTERN(double) emp_extinction_time(double t_speciation, const double* pars, unsigned n, const emp_node_t* tree)
 {
-  return t_speciation + trunc_exp(tree[n - 1].brts - t_speciation, pars[0], reng_);
+  return t_speciation + trunc_exp(tree[n - 1].brts - t_speciation, pars[0], random_stream());
 }
 
 
@@ -41,6 +122,40 @@ EMP_EXTERN(double) emp_nh_rate(double t, const double* pars, unsigned n, const e
 }
 
 
+EMP_EXTERN(void*) emp_create_state(const double* pars, unsigned n, const emp_node_t* tree)
+{
+  return new pd_cursor();
+}
+
+
+EMP_EXTERN(void) emp_free_state(void* state)
+{
+  delete static_cast<pd_cursor*>(state);
+}
+
+
+EMP_EXTERN(void) emp_invalidate_state(void* state, double t0, double t1)
+{
+  static_cast<pd_cursor*>(state)->invalidate(t0);
+}
+
+
+EMP_EXTERN(void) emp_advance_state(void* state, double t, unsigned n, const emp_node_t* tree)
+{
+  static_cast<pd_cursor*>(state)->pd(t, n, tree);
+}
+
+
+EMP_EXTERN(double) emp_nh_rate_state(void* state, double t, const double* pars, unsigned n, const emp_node_t* tree)
+{
+  auto cursor = static_cast<pd_cursor*>(state);
+  const double pd = cursor->pd(t, n, tree);
+  auto it = cursor->node(t, n, tree);
+  const double lambda = std::max(0.0, pars[1] + pars[2] * it->n + pars[3] * pd / it->n);
+  return lambda * it->n * (1.0 - std::exp(-pars[0] * (tree[n - 1].brts - t)));
+}
+
+
 EMP_EXTERN(double) emp_sampling_prob(const double* pars, unsigned n, const emp_node_t* tree)
 {
   mu_integral muint(pars[0], tree[n - 1].brts);
@@ -88,6 +203,50 @@ EMP_EXTERN(double) emp_loglik(const double* pars, unsigned n, const emp_node_t*
 }
 
 
+// loglik and sampling_prob in one pass
+EMP_EXTERN(double) emp_log_weight(const double* pars, unsigned n, const emp_node_t* tree, double* logf, double* logg)
+{
+  mu_integral muint(pars[0], tree[n - 1].brts);
+  log_sum log_lambda{};
+  int cex = 0;
+  double inte_f = 0.0;
+  double inte_g = 0.0;
+  double log_missing = 0.0;
+  double prev_brts = 0.0;
+  double tips = tree[0].n;
+  double Ne = 0.0;
+  for (unsigned i = 0; i < n; ++i) {
+    const auto& node = tree[i];
+    const double lambda = speciation_rate(pars, node);
+    if (is_extinction(node)) {
+      ++cex;
+    }
+    else if (i != n - 1) {
+      log_lambda += lambda;
+    }
+    inte_f += (node.brts - prev_brts) * node.n * (lambda + pars[0]);
+    inte_g += node.n * lambda * muint(prev_brts, node.brts);
+    tips += is_tip(node);
+    Ne -= is_extinction(node);
+    if (is_missing(node)) {
+      const double lifespan = node.t_ext - node.brts;
+      log_missing += std::log(node.n * pars[0] * lambda) - pars[0] * lifespan - std::log(2.0 * tips + Ne++);
+    }
+    prev_brts = node.brts;
+  }
+  *logf = std::log(pars[0]) * cex + log_lambda.result() - inte_f;
+  *logg = log_missing - inte_g;
+  return *logf - *logg;
+}
+
+
+EMP_EXTERN(void) emp_bd_rates(double t, const double* pars, double n, double pd, double* rates)
+{
+  rates[0] = std::max(0.0, pars[1] + pars[2] * n + pars[3] * pd / n);
+  rates[1] = pars[0];
+}
+
+
 EMP_EXTERN(void) emp_lower_bound(double* pars)
 {
   pars[0] = 10e-9; pars[1] = 10e-9; pars[2] = pars[3] = -100.0;